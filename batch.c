@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "tsp.h"
+
+// batch mode: solve many instances in one process on a pool of worker threads
+// every manifest line is "<inputfile> [outputfile]", the output defaults to <inputfile>.out
+// blank lines and lines starting with # are skipped; the manifest can be a file or stdin, and is
+// read as the workers ask for work, so instances can be streamed in while others are being solved
+
+#define MAX_PATH_LEN 4096
+
+typedef struct
+{
+    FILE *manifest;
+    pthread_mutex_t input_lock; // guards manifest reading and line_no; a worker may block in fgets on a
+                                // streamed manifest while holding it, so it never covers anything else
+    pthread_mutex_t lock;       // guards stdout and the counters
+    SolveOptions opt; // shared by every instance, workers only derive the seed
+    int line_no;
+    int solved, failed;
+} BatchQueue;
+
+// each worker keeps its buffers from one instance to the next, they only grow
+typedef struct
+{
+    BatchQueue *q;
+    SolverContext ctx;
+    City *cities;
+    int *tour;
+    int capacity;
+} BatchWorker;
+
+// next instance from the manifest, returns 0 when it is exhausted
+static int next_job(BatchQueue *q, char *input, char *output, int *line_no)
+{
+    char line[2 * MAX_PATH_LEN + 2];
+    int found = 0;
+    pthread_mutex_lock(&q->input_lock);
+    while (!found && fgets(line, sizeof(line), q->manifest))
+    {
+        q->line_no++;
+        output[0] = '\0';
+        if (sscanf(line, "%4095s %4095s", input, output) < 1 || input[0] == '#')
+            continue;
+        if (output[0] == '\0')
+            snprintf(output, MAX_PATH_LEN, "%.4091s.out", input);
+        *line_no = q->line_no;
+        found = 1;
+    }
+    pthread_mutex_unlock(&q->input_lock);
+    return found;
+}
+
+static int reserve_worker(BatchWorker *w, int n)
+{
+    if (n <= w->capacity)
+        return 0;
+    City *cities = realloc(w->cities, (size_t)n * sizeof(City));
+    if (cities)
+        w->cities = cities;
+    int *tour = realloc(w->tour, (size_t)n * sizeof(int));
+    if (tour)
+        w->tour = tour;
+    if (!cities || !tour)
+        return -1;
+    w->capacity = n;
+    return 0;
+}
+
+static int solve_job(BatchWorker *w, const char *input, const char *output, int line_no, unsigned long long *total_cost, int *visited, int *n_out)
+{
+    size_t len;
+    char *buf = read_file(input, &len);
+    if (!buf)
+        return -1;
+    int penalty, metric;
+    int n = parse_instance(buf, len, &penalty, &metric, w->cities, w->capacity);
+    if (n > w->capacity) // only counted, parse again with room for everything
+    {
+        if (reserve_worker(w, n) < 0)
+        {
+            free(buf);
+            return -1;
+        }
+        parse_instance(buf, len, &penalty, &metric, w->cities, w->capacity);
+    }
+    free(buf);
+    if (n <= 0)
+        return -1;
+
+    SolveOptions opt = w->q->opt;
+    opt.metric = metric;
+    opt.verbose = 0;
+    opt.threads = 1; // the batch already keeps every core busy
+    opt.seed = opt.seed ? opt.seed + (uint64_t)line_no : 0; // reproducible per instance, whatever thread gets it
+
+    if (solver_context_reserve(&w->ctx, n) != 0)
+        return -1;
+    int tour_size;
+    solve_instance(&w->ctx, &opt, w->cities, n, w->tour, &tour_size);
+
+    *total_cost = solver_total_cost(&w->ctx);
+    *visited = tour_size;
+    *n_out = n;
+    return write_output(output, w->cities, w->tour, tour_size, *total_cost);
+}
+
+static void *batch_worker(void *arg)
+{
+    BatchWorker *w = arg;
+    BatchQueue *q = w->q;
+    char input[MAX_PATH_LEN], output[MAX_PATH_LEN];
+    int line_no;
+    while (next_job(q, input, output, &line_no))
+    {
+        double t0 = solver_now();
+        unsigned long long total_cost = 0;
+        int visited = 0, n = 0;
+        int rc = solve_job(w, input, output, line_no, &total_cost, &visited, &n);
+        double secs = solver_now() - t0;
+
+        pthread_mutex_lock(&q->lock);
+        if (rc == 0)
+        {
+            q->solved++;
+            printf("%s -> %s: cities %d, visited %d, total cost %llu, %.4f seconds\n", input, output, n, visited, total_cost, secs);
+        }
+        else
+        {
+            q->failed++;
+            fprintf(stderr, "%s: failed (manifest line %d)\n", input, line_no);
+        }
+        fflush(stdout);
+        pthread_mutex_unlock(&q->lock);
+    }
+    return NULL;
+}
+
+int run_batch(FILE *manifest, int threads, const SolveOptions *opt)
+{
+    if (threads < 1)
+        threads = 1;
+
+    BatchQueue q;
+    q.manifest = manifest;
+    pthread_mutex_init(&q.input_lock, NULL);
+    pthread_mutex_init(&q.lock, NULL);
+    q.opt = *opt;
+    q.line_no = 0;
+    q.solved = q.failed = 0;
+
+    BatchWorker *workers = calloc((size_t)threads, sizeof(BatchWorker));
+    pthread_t *tids = malloc((size_t)threads * sizeof(pthread_t));
+    if (!workers || !tids)
+    {
+        fprintf(stderr, "Failed to allocate %d batch workers.\n", threads);
+        free(workers);
+        free(tids);
+        return -1;
+    }
+
+    double t0 = solver_now();
+    int started = 0;
+    for (int t = 0; t < threads; t++)
+    {
+        workers[t].q = &q;
+        if (pthread_create(&tids[t], NULL, batch_worker, &workers[t]) != 0)
+        {
+            fprintf(stderr, "Could only start %d of %d worker threads.\n", t, threads);
+            break;
+        }
+        started++;
+    }
+    if (started == 0) // no threads at all, work on the calling one
+        batch_worker(&workers[0]);
+    for (int t = 0; t < started; t++)
+        pthread_join(tids[t], NULL);
+
+    printf("Batch done: %d solved, %d failed, %d threads, %.4f seconds\n", q.solved, q.failed, started ? started : 1, solver_now() - t0);
+
+    for (int t = 0; t < threads; t++)
+    {
+        if (workers[t].ctx.arena.head)
+            solver_context_free(&workers[t].ctx);
+        free(workers[t].cities);
+        free(workers[t].tour);
+    }
+    free(workers);
+    free(tids);
+    pthread_mutex_destroy(&q.input_lock);
+    pthread_mutex_destroy(&q.lock);
+    return q.failed ? -1 : 0;
+}
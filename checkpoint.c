@@ -0,0 +1,337 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "tsp.h"
+
+// checkpoints of the default pipeline: long runs get preempted, and until write_output everything only
+// lives in memory. the kernels call checkpoint_poll between moves; once every interval seconds (and at
+// every phase boundary) it copies the tour and ctx->progress into a snapshot buffer and wakes a writer
+// thread, so the solver only pays for a memcpy. the writer turns the tour into city ids and writes
+//   <path>.tmp: this header, then tour_size int32 city ids (native byte order)
+// flushed to disk, then renamed over <path>: a crash mid-write leaves the previous checkpoint intact.
+// the skipped set is every city not on the tour, so the tour says it all.
+// a resume (solve_resume) maps the ids back to cities, restores the rng and carries on at the recorded
+// phase; random-region 2-opt continues at the region it was working on with the same draws.
+
+#define CHECKPOINT_MAGIC "TSPC"
+#define CHECKPOINT_VERSION 1
+
+typedef struct
+{
+    char magic[4];
+    int32_t version;
+    int32_t phase; // SolverProgress
+    int32_t pass;
+    uint64_t rng;
+    int32_t size_class;
+    int32_t cities;      // n of the instance
+    uint64_t instance;   // checkpoint_hash of the instance, a resume against other cities is refused
+    int64_t tour_size;
+    uint64_t total_cost; // at the snapshot, for whoever looks at the file
+} CheckpointHeader;
+
+struct Checkpointer
+{
+    char *path, *tmp;
+    double interval, next_due;
+    const City *cities;
+    int n;
+    uint64_t instance;
+
+    // the snapshot handed to the writer: owned by the writer while pending is set
+    CheckpointHeader head;
+    int *snap;
+    int pending, stop, failed;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+};
+
+static uint64_t mix64(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// order independent (solver_begin sorts the cities in place), so it is the same before and after
+static uint64_t checkpoint_hash(const City *cities, int n)
+{
+    uint64_t h = (uint64_t)n;
+    for (int c = 0; c < n; c++)
+    {
+        uint64_t v = mix64((uint64_t)(uint32_t)cities[c].id ^ ((uint64_t)(uint32_t)cities[c].x << 32));
+        v = mix64(v ^ (uint64_t)(uint32_t)cities[c].y ^ ((uint64_t)(uint32_t)cities[c].penalty << 32));
+        h += v;
+    }
+    return h;
+}
+
+// the directory entry of the rename has to reach the disk as well
+static void sync_directory(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    char dir[4096];
+    if (!slash)
+        strcpy(dir, ".");
+    else
+        snprintf(dir, sizeof(dir), "%.*s", slash == path ? 1 : (int)(slash - path), path);
+    int fd = open(dir, O_RDONLY);
+    if (fd >= 0)
+    {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+static int write_snapshot(Checkpointer *cp)
+{
+    int size = (int)cp->head.tour_size;
+    for (int i = 0; i < size; i++)
+        cp->snap[i] = cp->cities[cp->snap[i]].id; // indexes -> ids, in place
+
+    FILE *f = fopen(cp->tmp, "wb");
+    if (!f)
+    {
+        perror("Could not open checkpoint file");
+        return -1;
+    }
+    int ok = fwrite(&cp->head, sizeof(cp->head), 1, f) == 1 && fwrite(cp->snap, sizeof(int), (size_t)size, f) == (size_t)size;
+    ok = fflush(f) == 0 && ok;
+    ok = fsync(fileno(f)) == 0 && ok;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(cp->tmp, cp->path) != 0)
+    {
+        perror("Could not write checkpoint");
+        remove(cp->tmp);
+        return -1;
+    }
+    sync_directory(cp->path);
+    return 0;
+}
+
+static void *checkpoint_writer(void *arg)
+{
+    Checkpointer *cp = arg;
+    pthread_mutex_lock(&cp->lock);
+    for (;;)
+    {
+        while (!cp->pending && !cp->stop)
+            pthread_cond_wait(&cp->changed, &cp->lock);
+        if (!cp->pending)
+            break;
+        pthread_mutex_unlock(&cp->lock);
+        int rc = write_snapshot(cp);
+        pthread_mutex_lock(&cp->lock);
+        if (rc != 0)
+            cp->failed = 1;
+        cp->pending = 0;
+        pthread_cond_broadcast(&cp->changed);
+    }
+    pthread_mutex_unlock(&cp->lock);
+    return NULL;
+}
+
+// snapshot of the solver state for the writer, called with the lock held and the writer idle
+static void take_snapshot(Checkpointer *cp, const SolverContext *ctx, const int *tour, int tour_size)
+{
+    memcpy(cp->head.magic, CHECKPOINT_MAGIC, 4);
+    cp->head.version = CHECKPOINT_VERSION;
+    cp->head.phase = ctx->progress.phase;
+    cp->head.pass = ctx->progress.pass;
+    cp->head.rng = ctx->progress.rng;
+    cp->head.size_class = ctx->progress.size_class;
+    cp->head.cities = cp->n;
+    cp->head.instance = cp->instance;
+    cp->head.tour_size = tour_size;
+    cp->head.total_cost = solver_total_cost(ctx);
+    memcpy(cp->snap, tour, (size_t)tour_size * sizeof(int));
+    cp->pending = 1;
+    pthread_cond_broadcast(&cp->changed);
+}
+
+// starts the writer thread; cities must be the array the solver works on (ids are looked up at write time)
+Checkpointer *checkpoint_start(const char *path, double interval, const City *cities, int n)
+{
+    Checkpointer *cp = calloc(1, sizeof(Checkpointer));
+    if (!cp)
+        return NULL;
+    size_t len = strlen(path);
+    cp->path = malloc(len + 1);
+    cp->tmp = malloc(len + 5);
+    cp->snap = malloc((size_t)n * sizeof(int) + sizeof(int));
+    if (!cp->path || !cp->tmp || !cp->snap)
+    {
+        fprintf(stderr, "Failed to allocate memory for checkpoints of %d cities.\n", n);
+        exit(1);
+    }
+    memcpy(cp->path, path, len + 1);
+    snprintf(cp->tmp, len + 5, "%s.tmp", path);
+    cp->interval = interval;
+    cp->next_due = solver_now() + interval;
+    cp->cities = cities;
+    cp->n = n;
+    cp->instance = checkpoint_hash(cities, n);
+    pthread_mutex_init(&cp->lock, NULL);
+    pthread_cond_init(&cp->changed, NULL);
+    if (pthread_create(&cp->thread, NULL, checkpoint_writer, cp) != 0)
+    {
+        fprintf(stderr, "Could not start the checkpoint writer\n");
+        pthread_mutex_destroy(&cp->lock);
+        pthread_cond_destroy(&cp->changed);
+        free(cp->path);
+        free(cp->tmp);
+        free(cp->snap);
+        free(cp);
+        return NULL;
+    }
+    return cp;
+}
+
+// force: phase boundary, take a snapshot whatever the time. if the writer is still busy with the last
+// one this one is dropped and the next poll tries again, the solver never waits for the disk
+void checkpoint_poll(SolverContext *ctx, const int *tour, int tour_size, int force)
+{
+    Checkpointer *cp = ctx->checkpoint;
+    if (!cp)
+        return;
+    double now = solver_now();
+    if (!force && now < cp->next_due)
+        return;
+    pthread_mutex_lock(&cp->lock);
+    if (!cp->pending)
+    {
+        take_snapshot(cp, ctx, tour, tour_size);
+        cp->next_due = now + cp->interval;
+    }
+    pthread_mutex_unlock(&cp->lock);
+}
+
+// final snapshot of the finished run, then the writer is stopped and everything freed
+// returns 0, or -1 if any checkpoint could not be written
+int checkpoint_finish(Checkpointer *cp, SolverContext *ctx, const int *tour, int tour_size)
+{
+    if (!cp)
+        return 0;
+    pthread_mutex_lock(&cp->lock);
+    while (cp->pending)
+        pthread_cond_wait(&cp->changed, &cp->lock);
+    take_snapshot(cp, ctx, tour, tour_size);
+    cp->stop = 1;
+    pthread_mutex_unlock(&cp->lock);
+    pthread_join(cp->thread, NULL);
+
+    int failed = cp->failed;
+    if (ctx->checkpoint == cp)
+        ctx->checkpoint = NULL;
+    pthread_mutex_destroy(&cp->lock);
+    pthread_cond_destroy(&cp->changed);
+    free(cp->path);
+    free(cp->tmp);
+    free(cp->snap);
+    free(cp);
+    return failed ? -1 : 0;
+}
+
+// reads a checkpoint written for these cities and options; returns the malloc'ed tour ids (count in
+// *count) and fills *progress, NULL if the file is unreadable, belongs to another instance or records
+// progress the pipeline cannot resume from
+int *checkpoint_load(const char *path, const SolveOptions *opt, const City *cities, int n, SolverProgress *progress, int *count)
+{
+    size_t len;
+    char *buf = read_file(path, &len);
+    if (!buf)
+        return NULL;
+    CheckpointHeader head;
+    if (len < sizeof(head))
+    {
+        fprintf(stderr, "%s: not a checkpoint file\n", path);
+        free(buf);
+        return NULL;
+    }
+    memcpy(&head, buf, sizeof(head));
+    const char *problem = NULL;
+    if (memcmp(head.magic, CHECKPOINT_MAGIC, 4) != 0)
+        problem = "not a checkpoint file";
+    else if (head.version != CHECKPOINT_VERSION)
+        problem = "unsupported checkpoint version";
+    else if (head.cities != n || head.instance != checkpoint_hash(cities, n))
+        problem = "checkpoint of a different instance";
+    else if (head.phase < PHASE_CONSTRUCT || head.phase > PHASE_DONE || head.tour_size < 0 || head.tour_size > n ||
+             len != sizeof(head) + (size_t)head.tour_size * sizeof(int32_t))
+        problem = "checkpoint file is damaged";
+    // what solve_phases can carry on from: a region count only inside random-region 2-opt (the two 2-opt
+    // phases), and the size that picked the 2-opt variant covers the tour it was picked for
+    else if (head.pass < 0 || head.pass > opt->regions || (head.pass > 0 && head.phase != PHASE_OPTIMIZE && head.phase != PHASE_REFINE) ||
+             head.size_class < 0 || head.size_class > n || (head.phase > PHASE_CONSTRUCT && head.size_class < head.tour_size))
+        problem = "checkpoint progress is out of range";
+    if (problem)
+    {
+        fprintf(stderr, "%s: %s\n", path, problem);
+        free(buf);
+        return NULL;
+    }
+
+    int *ids = malloc((size_t)head.tour_size * sizeof(int) + sizeof(int));
+    if (!ids)
+    {
+        fprintf(stderr, "Failed to allocate memory for %lld tour cities.\n", (long long)head.tour_size);
+        exit(1);
+    }
+    memcpy(ids, buf + sizeof(head), (size_t)head.tour_size * sizeof(int));
+    free(buf);
+    progress->phase = head.phase;
+    progress->pass = head.pass;
+    progress->rng = head.rng;
+    progress->size_class = head.size_class;
+    *count = (int)head.tour_size;
+    return ids;
+}
+
+static const char *phase_name(int phase)
+{
+    static const char *names[] = {"construct", "optimize", "prune", "refine", "done"};
+    return names[phase];
+}
+
+// continue a run from checkpoint_load's state; opt should be the options of the interrupted run, the
+// time limit starts over
+void solve_resume(SolverContext *ctx, const SolveOptions *opt, City *cities, int n, const SolverProgress *from, const int *ids, int count, int *tour, int *tour_size)
+{
+    solver_begin(ctx, opt, cities, n);
+    ArenaMark mark = arena_mark(&ctx->arena);
+    IdMap by_id;
+    id_map_init(&by_id, &ctx->arena, cities, n);
+
+    // the instance hash matched, so every id is there; a city listed twice only counts once
+    char *on_tour = ctx->marks;
+    memset(on_tour, 0, (size_t)n);
+    int m = 0;
+    for (int i = 0; i < count; i++)
+    {
+        int c = id_map_find(&by_id, ids[i]);
+        if (c >= 0 && !on_tour[c])
+        {
+            on_tour[c] = 1;
+            tour[m++] = c;
+        }
+    }
+    arena_release(&ctx->arena, mark);
+
+    *tour_size = m;
+    solver_set_tour(ctx, cities, tour, m, n);
+    ctx->progress = *from;
+    ctx->rng = from->rng;
+    if (ctx->verbose)
+        printf("Resuming at phase %s (pass %d): %d of %d cities on the tour, total cost %llu\n", phase_name(from->phase), from->pass, m, n, solver_total_cost(ctx));
+
+    // nothing on the tour yet (interrupted before the first snapshot of a tour): start over
+    if (m == 0 && n > 0)
+        ctx->progress.phase = PHASE_CONSTRUCT;
+    solve_phases(ctx, opt, cities, n, tour, tour_size);
+}
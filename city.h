@@ -7,6 +7,7 @@
 typedef struct {
     int id;
     int x, y;
+    int penalty; // cost of skipping this city (fits in the padding before morton)
     uint64_t morton;
 } City;
 
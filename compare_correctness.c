@@ -1,21 +1,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "city.h"
+#include "tsp.h"
 #include <math.h>
 #include <stdint.h>
 #include <limits.h>
 
 // compile option -- gcc compare_correctness.c tsp.c tspw_brute_force.c -o compare_program -lm
 
-#define MAX_LINE 100
 #define MAX_CITIES 5000
 #define MAX_N 5
 
-int read_input(const char *filename, int *penalty, City *cities);
-int compare_morton(const void *a, const void *b);
-uint64_t morton_code(int x, int y);
-int distance(const City *a, const City *b);
 void tsp_bruteforce(City *cities, int n, int *perm, int l, long long *min_len, int *best_perm);
 
 int main()
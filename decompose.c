@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "tsp.h"
+
+// decomposition for very large inputs: no single 2-opt pass can cover the whole problem in time,
+// so the cities (already sorted by Morton code) are cut into consecutive runs of cluster_size.
+// a run of the Morton curve is a compact region, each one is solved as its own instance with the
+// usual pipeline (2-opt + pruning) on a pool of threads, then the cluster tours are joined in
+// Morton order and the seams between them get a windowed 2-opt repair.
+
+#define SEAM_WINDOW 200 // tour positions on each side of a seam the repair looks at
+
+typedef struct
+{
+    const SolveOptions *opt;
+    City *cities;
+    int *tour;         // cluster k writes its tour (global indexes) at tour[start[k]..]
+    int *start;        // first city of every cluster, start[clusters] = n
+    int *size;         // cities left on every cluster tour
+    int clusters;
+    int next_cluster;  // work queue
+    int failed;        // a worker ran out of memory
+    double deadline;   // of the whole solve, 0 = none
+    pthread_mutex_t lock;
+} ClusterJobs;
+
+// takes clusters off the queue until there are none left; returns -1 if ctx ran out of memory (the
+// caller's jmp_buf belongs to another thread, so this one catches it and solve_decomposed passes it on)
+static int solve_clusters(ClusterJobs *jobs, SolverContext *ctx)
+{
+    jmp_buf failed;
+    if (setjmp(failed))
+        return -1;
+    for (;;)
+    {
+        pthread_mutex_lock(&jobs->lock);
+        int k = jobs->failed ? jobs->clusters : jobs->next_cluster++;
+        pthread_mutex_unlock(&jobs->lock);
+        if (k >= jobs->clusters)
+            break;
+
+        int lo = jobs->start[k], m = jobs->start[k + 1] - lo;
+        SolveOptions sub = *jobs->opt;
+        sub.decompose = 0;
+        sub.verbose = 0;
+        sub.seed = sub.seed ? sub.seed + (uint64_t)k : 0;
+        if (jobs->deadline > 0)
+        {
+            // what is left of the budget when the cluster starts; time_limit <= 0 would mean no limit at
+            // all, so a cluster started after the deadline still gets a token one and stops right away
+            double left = jobs->deadline - solver_now();
+            sub.time_limit = left > 1e-3 ? left : 1e-3;
+        }
+        if (solver_context_reserve(ctx, m) != 0)
+            return -1;
+        ctx->arena.on_failure = &failed;
+        // a cluster is a plain instance over its slice of the city array, its tour indexes are local
+        int *local = jobs->tour + lo;
+        solve_instance(ctx, &sub, jobs->cities + lo, m, local, &jobs->size[k]);
+        for (int i = 0; i < jobs->size[k]; i++)
+            local[i] += lo;
+        ctx->arena.on_failure = NULL;
+    }
+    return 0;
+}
+
+static void *cluster_worker(void *arg)
+{
+    ClusterJobs *jobs = arg;
+    SolverContext ctx = {0};
+    if (solve_clusters(jobs, &ctx) != 0)
+    {
+        pthread_mutex_lock(&jobs->lock);
+        jobs->failed = 1; // the other workers stop taking clusters
+        pthread_mutex_unlock(&jobs->lock);
+    }
+    if (ctx.arena.head)
+        solver_context_free(&ctx);
+    return NULL;
+}
+
+void solve_decomposed(SolverContext *ctx, const SolveOptions *opt, City *cities, int n, int *tour, int *tour_size)
+{
+    int clusters = (n + opt->cluster_size - 1) / opt->cluster_size;
+    ArenaMark mark = arena_mark(&ctx->arena);
+
+    ClusterJobs jobs;
+    jobs.opt = opt;
+    jobs.cities = cities;
+    jobs.tour = tour;
+    jobs.start = arena_alloc(&ctx->arena, (size_t)(clusters + 1) * sizeof(int));
+    jobs.size = arena_alloc(&ctx->arena, (size_t)clusters * sizeof(int));
+    jobs.clusters = clusters;
+    jobs.next_cluster = 0;
+    jobs.failed = 0;
+    jobs.deadline = ctx->deadline;
+    pthread_mutex_init(&jobs.lock, NULL);
+    for (int k = 0; k <= clusters; k++)
+        jobs.start[k] = (int)((long long)n * k / clusters); // even sizes
+
+    if (ctx->verbose)
+        printf("Decomposition: %d clusters of about %d cities on %d threads...\n", clusters, n / clusters, opt->threads);
+
+    int threads = opt->threads < 1 ? 1 : (opt->threads > clusters ? clusters : opt->threads);
+    pthread_t *tids = arena_alloc(&ctx->arena, (size_t)threads * sizeof(pthread_t));
+    int started = 0;
+    for (int t = 0; t < threads; t++)
+    {
+        if (pthread_create(&tids[t], NULL, cluster_worker, &jobs) != 0)
+            break;
+        started++;
+    }
+    if (started == 0) // no threads at all, work on the calling one
+        cluster_worker(&jobs);
+    for (int t = 0; t < started; t++)
+        pthread_join(tids[t], NULL);
+    pthread_mutex_destroy(&jobs.lock);
+    if (jobs.failed)
+        arena_out_of_memory(&ctx->arena, 0);
+
+    // stitch: walk the clusters in Morton order, enter each cluster tour at its city closest to where the
+    // previous one was left, and go round it in the direction that drops the longer edge next to the entry
+    int *joined = ctx->scratch;
+    int *seams = arena_alloc(&ctx->arena, (size_t)clusters * sizeof(int));
+    int m = 0, seam_count = 0;
+    for (int k = 0; k < clusters; k++)
+    {
+        const int *ct = tour + jobs.start[k];
+        int cn = jobs.size[k];
+        if (cn == 0)
+            continue;
+        int entry = 0;
+        if (m > 0)
+        {
+            const City *exit = &cities[joined[m - 1]];
+            for (int i = 1; i < cn; i++)
+                if (metric_distance(ctx->metric, exit, &cities[ct[i]]) < metric_distance(ctx->metric, exit, &cities[ct[entry]]))
+                    entry = i;
+        }
+        int before = entry == 0 ? cn - 1 : entry - 1, after = entry + 1 == cn ? 0 : entry + 1;
+        int forward = metric_distance(ctx->metric, &cities[ct[entry]], &cities[ct[before]]) >= metric_distance(ctx->metric, &cities[ct[entry]], &cities[ct[after]]);
+        if (m > 0)
+            seams[seam_count++] = m;
+        for (int i = 0, p = entry; i < cn; i++)
+        {
+            joined[m++] = ct[p];
+            p = forward ? (p + 1 == cn ? 0 : p + 1) : (p == 0 ? cn - 1 : p - 1);
+        }
+    }
+    // two_opt_segment never wraps, so rotate the closing seam (last cluster -> first) into the middle
+    // of the first cluster tour; it becomes an ordinary seam at m - shift and the new ends of the array
+    // are well inside a cluster
+    int shift = (seam_count > 0 ? seams[0] : m) / 2;
+    for (int s = 0; s < seam_count; s++)
+        seams[s] -= shift;
+    if (seam_count > 0)
+        seams[seam_count++] = m - shift;
+    memcpy(tour, joined + shift, (size_t)(m - shift) * sizeof(int));
+    memcpy(tour + m - shift, joined, (size_t)shift * sizeof(int));
+    *tour_size = m;
+    solver_set_tour(ctx, cities, tour, m, n);
+
+    if (ctx->verbose)
+        printf("Stitched %d cluster tours: %d cities, length %llu\n", clusters, m, ctx->tour_len);
+
+    // repair: windowed 2-opt around every seam, then one more pruning pass for cities the seams made expensive
+    for (int s = 0; s < seam_count && !solver_out_of_time(ctx); s++)
+        two_opt_segment(ctx, cities, tour, m, seams[s] - SEAM_WINDOW, seams[s] + SEAM_WINDOW);
+    prune_tour(ctx, cities, tour, tour_size);
+
+    if (ctx->verbose)
+        printf("Seam repair done: %d cities, length %llu\n", *tour_size, ctx->tour_len);
+
+    arena_release(&ctx->arena, mark);
+}
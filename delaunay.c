@@ -0,0 +1,389 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tsp.h"
+
+// Delaunay triangulation as a candidate graph: every instance is planar integer x/y with Euclidean
+// distance(), and the Delaunay edges (about 3n of them, 6 per city) contain nearly every edge of a good
+// tour. built incrementally in Morton order (each point is located by walking from the triangle the
+// previous one went into, so the walk is short) with Lawson edge flips, O(n log n) in practice.
+// predicates are exact integer arithmetic for any int coordinates, enclosing corners included:
+// orientation in 128 bit, in-circle in 128 bit while the box is small enough and 256 bit beyond that.
+// the triangulation starts from a big enclosing triangle whose corners are dropped at the end; near the
+// convex hull that can leave out a few hull edges, which does not matter for candidate lists.
+
+typedef struct
+{
+    int v[3];   // corners, counter clockwise
+    int adj[3]; // adj[i] is the triangle across the edge opposite v[i], -1 if none
+} Triangle;
+
+typedef struct
+{
+    long long *x, *y; // points, the three enclosing corners are n, n+1, n+2
+    Triangle *t;
+    int count;
+    int *stack; // triangles (times 3, plus edge) waiting for a legality check
+    int stack_size;
+    int wide;   // coordinate differences can reach 2^30: in_circle needs more than 128 bits
+} Triangulation;
+
+// differences between any two points (corners included) stay below 2^38 for int input, products of
+// two of them below 2^77, so the orientation always fits 128 bits; the sign of it
+static int orient(const Triangulation *tr, int a, int b, int c)
+{
+    __int128 det = (__int128)(tr->x[b] - tr->x[a]) * (tr->y[c] - tr->y[a]) - (__int128)(tr->y[b] - tr->y[a]) * (tr->x[c] - tr->x[a]);
+    return (det > 0) - (det < 0);
+}
+
+// 256 bit two's complement, least significant word first: just enough for the in-circle determinant
+// of far apart points, |lift * cross| < 2^156
+typedef struct
+{
+    uint64_t w[4];
+} Int256;
+
+static Int256 mul_wide(__int128 a, __int128 b)
+{
+    int negative = (a < 0) != (b < 0);
+    unsigned __int128 ua = a < 0 ? -(unsigned __int128)a : (unsigned __int128)a;
+    unsigned __int128 ub = b < 0 ? -(unsigned __int128)b : (unsigned __int128)b;
+    uint64_t a0 = (uint64_t)ua, a1 = (uint64_t)(ua >> 64), b0 = (uint64_t)ub, b1 = (uint64_t)(ub >> 64);
+    unsigned __int128 p00 = (unsigned __int128)a0 * b0, p01 = (unsigned __int128)a0 * b1;
+    unsigned __int128 p10 = (unsigned __int128)a1 * b0, p11 = (unsigned __int128)a1 * b1;
+    unsigned __int128 mid = (p00 >> 64) + (uint64_t)p01 + (uint64_t)p10; // at most 3 * (2^64 - 1)
+    unsigned __int128 high = (mid >> 64) + (p01 >> 64) + (p10 >> 64) + p11;
+    Int256 r = {{(uint64_t)p00, (uint64_t)mid, (uint64_t)high, (uint64_t)(high >> 64)}};
+    if (negative) // ~r + 1
+    {
+        unsigned carry = 1;
+        for (int i = 0; i < 4; i++)
+        {
+            r.w[i] = ~r.w[i] + carry;
+            carry = carry && r.w[i] == 0;
+        }
+    }
+    return r;
+}
+
+static Int256 add_wide(Int256 a, Int256 b)
+{
+    Int256 r;
+    unsigned carry = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        unsigned __int128 s = (unsigned __int128)a.w[i] + b.w[i] + carry;
+        r.w[i] = (uint64_t)s;
+        carry = (unsigned)(s >> 64);
+    }
+    return r;
+}
+
+// > 0 if d lies inside the circumcircle of the counter clockwise triangle a b c
+// with differences below 2^30 every term is below 4 * 2^120 and the sum fits 128 bits
+static int in_circle(const Triangulation *tr, int a, int b, int c, int d)
+{
+    __int128 adx = tr->x[a] - tr->x[d], ady = tr->y[a] - tr->y[d];
+    __int128 bdx = tr->x[b] - tr->x[d], bdy = tr->y[b] - tr->y[d];
+    __int128 cdx = tr->x[c] - tr->x[d], cdy = tr->y[c] - tr->y[d];
+    __int128 alift = adx * adx + ady * ady, blift = bdx * bdx + bdy * bdy, clift = cdx * cdx + cdy * cdy;
+    __int128 across = bdx * cdy - cdx * bdy, bcross = cdx * ady - adx * cdy, ccross = adx * bdy - bdx * ady;
+    if (!tr->wide)
+        return alift * across + blift * bcross + clift * ccross > 0;
+    Int256 det = add_wide(add_wide(mul_wide(alift, across), mul_wide(blift, bcross)), mul_wide(clift, ccross));
+    return (int64_t)det.w[3] >= 0 && (det.w[0] | det.w[1] | det.w[2] | det.w[3]) != 0;
+}
+
+static void set_tri(Triangulation *tr, int t, int a, int b, int c, int na, int nb, int nc)
+{
+    Triangle *T = &tr->t[t];
+    T->v[0] = a;
+    T->v[1] = b;
+    T->v[2] = c;
+    T->adj[0] = na;
+    T->adj[1] = nb;
+    T->adj[2] = nc;
+}
+
+// the neighbour u used to point at old, now it points at new
+static void repoint(Triangulation *tr, int u, int old, int new_t)
+{
+    if (u < 0)
+        return;
+    for (int i = 0; i < 3; i++)
+        if (tr->t[u].adj[i] == old)
+        {
+            tr->t[u].adj[i] = new_t;
+            return;
+        }
+}
+
+// restore the Delaunay property around the new point p, which sits at v[0] of every queued triangle
+static void legalize(Triangulation *tr)
+{
+    while (tr->stack_size > 0)
+    {
+        int t = tr->stack[--tr->stack_size];
+        int u = tr->t[t].adj[0];
+        if (u < 0)
+            continue;
+        int p = tr->t[t].v[0], x = tr->t[t].v[1], y = tr->t[t].v[2];
+        int j = 0;
+        while (tr->t[u].adj[j] != t)
+            j++;
+        int q = tr->t[u].v[j]; // u is (q, y, x) rotated so that q is at j
+        if (!in_circle(tr, p, x, y, q))
+            continue;
+
+        // flip edge x-y to p-q: t = (p, x, q), u = (p, q, y)
+        int t_yp = tr->t[t].adj[1], t_px = tr->t[t].adj[2];
+        int u_xq = tr->t[u].adj[(j + 1) % 3], u_qy = tr->t[u].adj[(j + 2) % 3];
+        set_tri(tr, t, p, x, q, u_xq, u, t_px);
+        set_tri(tr, u, p, q, y, u_qy, t_yp, t);
+        repoint(tr, u_xq, u, t);
+        repoint(tr, t_yp, t, u);
+        tr->stack[tr->stack_size++] = t;
+        tr->stack[tr->stack_size++] = u;
+    }
+}
+
+// triangle containing p (on its border counts), walking from triangle start
+static int locate(const Triangulation *tr, int start, int p)
+{
+    int t = start;
+    long long steps = 0;
+    for (;;)
+    {
+        const Triangle *T = &tr->t[t];
+        int moved = 0;
+        for (int i = 0; i < 3; i++)
+        {
+            if (orient(tr, T->v[(i + 1) % 3], T->v[(i + 2) % 3], p) < 0)
+            {
+                t = T->adj[i];
+                moved = 1;
+                break;
+            }
+        }
+        if (!moved)
+            return t;
+        if (++steps > 4LL * tr->count + 16) // should not happen on a Delaunay mesh, scan everything
+        {
+            for (int s = 0; s < tr->count; s++)
+            {
+                const Triangle *S = &tr->t[s];
+                if (orient(tr, S->v[0], S->v[1], p) >= 0 && orient(tr, S->v[1], S->v[2], p) >= 0 && orient(tr, S->v[2], S->v[0], p) >= 0)
+                    return s;
+            }
+            return start;
+        }
+    }
+}
+
+// adds point p, returns the triangle it went into, or -1 if p coincides with a corner (*twin receives it)
+static int insert_point(Triangulation *tr, int start, int p, int *twin)
+{
+    int t = locate(tr, start, p);
+    Triangle T = tr->t[t];
+    int o[3];
+    int zeros = 0, on_edge = -1;
+    for (int i = 0; i < 3; i++)
+    {
+        o[i] = orient(tr, T.v[(i + 1) % 3], T.v[(i + 2) % 3], p);
+        if (o[i] == 0)
+        {
+            zeros++;
+            on_edge = i;
+        }
+    }
+    if (zeros >= 2) // same position as a corner of t
+    {
+        for (int i = 0; i < 3; i++)
+            if (o[i] != 0)
+                *twin = T.v[i];
+        return -1;
+    }
+
+    if (zeros == 0)
+    {
+        // split t into three around p
+        int a = T.v[0], b = T.v[1], c = T.v[2];
+        int na = T.adj[0], nb = T.adj[1], nc = T.adj[2];
+        int t1 = tr->count++, t2 = tr->count++;
+        set_tri(tr, t, p, b, c, na, t1, t2);
+        set_tri(tr, t1, p, c, a, nb, t2, t);
+        set_tri(tr, t2, p, a, b, nc, t, t1);
+        repoint(tr, nb, t, t1);
+        repoint(tr, nc, t, t2);
+        tr->stack[tr->stack_size++] = t;
+        tr->stack[tr->stack_size++] = t1;
+        tr->stack[tr->stack_size++] = t2;
+    }
+    else
+    {
+        // p on the edge b-c opposite a: split t and the triangle u across that edge into four
+        int i = on_edge;
+        int a = T.v[i], b = T.v[(i + 1) % 3], c = T.v[(i + 2) % 3];
+        int t_ca = T.adj[(i + 1) % 3], t_ab = T.adj[(i + 2) % 3];
+        int u = T.adj[i];
+        int j = 0;
+        while (tr->t[u].adj[j] != t)
+            j++;
+        int q = tr->t[u].v[j];
+        int u_bq = tr->t[u].adj[(j + 1) % 3], u_qc = tr->t[u].adj[(j + 2) % 3];
+        int t2 = tr->count++, u2 = tr->count++;
+        set_tri(tr, t, p, a, b, t_ab, u2, t2);
+        set_tri(tr, t2, p, c, a, t_ca, t, u);
+        set_tri(tr, u, p, q, c, u_qc, t2, u2);
+        set_tri(tr, u2, p, b, q, u_bq, u, t);
+        repoint(tr, t_ca, t, t2);
+        repoint(tr, u_bq, u, u2);
+        tr->stack[tr->stack_size++] = t;
+        tr->stack[tr->stack_size++] = t2;
+        tr->stack[tr->stack_size++] = u;
+        tr->stack[tr->stack_size++] = u2;
+    }
+    legalize(tr);
+    return t;
+}
+
+// candidate list of c in order of the instance metric, which two_opt_neighbors relies on to stop early.
+// insertion sort, lists are short (6 on average) and come close to sorted (by plane distance), and it is
+// stable: metrics that only round the plane distance (EUC_2D, CEIL_2D, ATT) leave them as they are
+void sort_candidates(int metric, const City *cities, int c, int *list, int len)
+{
+    for (int i = 1; i < len; i++)
+    {
+        int v = list[i], dv = metric_distance(metric, &cities[c], &cities[v]);
+        int k = i - 1;
+        while (k >= 0 && metric_distance(metric, &cities[c], &cities[list[k]]) > dv)
+        {
+            list[k + 1] = list[k];
+            k--;
+        }
+        list[k + 1] = v;
+    }
+}
+
+// Delaunay neighbours of every city as a candidate graph, each list sorted closest first (by metric)
+// cities are expected in Morton order (solve_instance sorts them), any order works but walks get longer
+void build_delaunay_candidates(Arena *arena, int metric, const City *cities, int n, CandidateGraph *cg)
+{
+    cg->start = arena_alloc(arena, (size_t)(n + 1) * sizeof(int));
+    if (n < 2)
+    {
+        cg->adj = arena_alloc(arena, sizeof(int));
+        for (int i = 0; i <= n; i++)
+            cg->start[i] = 0;
+        return;
+    }
+
+    // a planar graph has at most 3n - 6 edges, both directions of each plus one twin link per duplicate
+    cg->adj = arena_alloc(arena, (size_t)(8 * n + 16) * sizeof(int));
+    ArenaMark mark = arena_mark(arena);
+    Triangulation tr;
+    tr.x = arena_alloc(arena, (size_t)(n + 3) * sizeof(long long));
+    tr.y = arena_alloc(arena, (size_t)(n + 3) * sizeof(long long));
+    int max_tri = 2 * (n + 3) + 1;
+    tr.t = arena_alloc(arena, (size_t)max_tri * sizeof(Triangle));
+    tr.stack = arena_alloc(arena, (size_t)max_tri * sizeof(int));
+    tr.stack_size = 0;
+    int *twin = arena_alloc(arena, (size_t)n * sizeof(int));
+
+    long long min_x = cities[0].x, max_x = cities[0].x, min_y = cities[0].y, max_y = cities[0].y;
+    for (int i = 0; i < n; i++)
+    {
+        tr.x[i] = cities[i].x;
+        tr.y[i] = cities[i].y;
+        twin[i] = -1;
+        if (cities[i].x < min_x)
+            min_x = cities[i].x;
+        if (cities[i].x > max_x)
+            max_x = cities[i].x;
+        if (cities[i].y < min_y)
+            min_y = cities[i].y;
+        if (cities[i].y > max_y)
+            max_y = cities[i].y;
+    }
+    // enclosing triangle, far enough that it hardly bends the hull
+    long long r = (max_x - min_x > max_y - min_y ? max_x - min_x : max_y - min_y) + 1;
+    long long cx = (min_x + max_x) / 2, cy = (min_y + max_y) / 2;
+    tr.x[n] = cx - 20 * r;
+    tr.y[n] = cy - 10 * r;
+    tr.x[n + 1] = cx + 20 * r;
+    tr.y[n + 1] = cy - 10 * r;
+    tr.x[n + 2] = cx;
+    tr.y[n + 2] = cy + 20 * r;
+    tr.wide = 40 * r >= (1LL << 30); // the widest difference is between two corners
+    set_tri(&tr, 0, n, n + 1, n + 2, -1, -1, -1);
+    tr.count = 1;
+
+    int last = 0;
+    for (int p = 0; p < n; p++)
+    {
+        int t = insert_point(&tr, last, p, &twin[p]);
+        if (t >= 0)
+            last = t;
+    }
+
+    // every edge once (from the triangle with the lower index, or the only one), between real cities only
+    int *degree = cg->start;
+    memset(degree, 0, (size_t)(n + 1) * sizeof(int));
+    for (int t = 0; t < tr.count; t++)
+        for (int i = 0; i < 3; i++)
+        {
+            int a = tr.t[t].v[(i + 1) % 3], b = tr.t[t].v[(i + 2) % 3], u = tr.t[t].adj[i];
+            if (a < n && b < n && (u < 0 || u > t))
+            {
+                degree[a]++;
+                degree[b]++;
+            }
+        }
+    // a duplicate city is linked to its twin only, at distance 0 that is the one edge it needs
+    for (int c = 0; c < n; c++)
+        if (twin[c] >= 0)
+        {
+            degree[c]++;
+            degree[twin[c]]++;
+        }
+
+    int total = 0;
+    for (int c = 0; c <= n; c++)
+    {
+        int d = degree[c];
+        cg->start[c] = total;
+        total += d;
+    }
+    int *fill = arena_alloc(arena, (size_t)n * sizeof(int)); // write cursor of every list
+    for (int c = 0; c < n; c++)
+        fill[c] = cg->start[c];
+    for (int t = 0; t < tr.count; t++)
+        for (int i = 0; i < 3; i++)
+        {
+            int a = tr.t[t].v[(i + 1) % 3], b = tr.t[t].v[(i + 2) % 3], u = tr.t[t].adj[i];
+            if (a < n && b < n && (u < 0 || u > t))
+            {
+                cg->adj[fill[a]++] = b;
+                cg->adj[fill[b]++] = a;
+            }
+        }
+    for (int c = 0; c < n; c++)
+        if (twin[c] >= 0)
+        {
+            cg->adj[fill[c]++] = twin[c];
+            cg->adj[fill[twin[c]]++] = c;
+        }
+    for (int c = 0; c < n; c++)
+        sort_candidates(metric, cities, c, cg->adj + cg->start[c], cg->start[c + 1] - cg->start[c]);
+    arena_release(arena, mark);
+}
+
+// candidate graph of the given kind (CANDIDATES_KNN with k neighbours, or CANDIDATES_DELAUNAY), lists
+// sorted closest first by metric (METRIC_*)
+void build_candidates(Arena *arena, int kind, int metric, const City *cities, int n, int k, CandidateGraph *cg)
+{
+    if (kind == CANDIDATES_DELAUNAY)
+        build_delaunay_candidates(arena, metric, cities, n, cg);
+    else
+        build_knn_candidates(arena, metric, cities, n, k, cg);
+}
@@ -0,0 +1,493 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "tsp.h"
+
+// synthetic instance generator for benchmarks, replaces create_test_file.py
+//   uniform  points uniform in the square (what create_test_file.py wrote)
+//   cluster  gaussian clusters of different spreads around uniform centers
+//   grid     a square lattice, every distance between neighbours equal (ties everywhere)
+//   road     points along random winding polylines with a little sideways noise, like addresses on roads
+// penalties: one value on the first line (const), or per city (4th column): uniform in [0, 2P],
+// exponential with mean P, or bimodal (most cities P/2, a fifth 3P)
+// cities are generated in fixed size chunks on a pool of threads, chunk k from its own random stream
+// derived from the seed, so the same seed gives the same file whatever the thread count. the main
+// thread writes the chunks in order as they come in.
+// compile option -- gcc -O2 -o gen_instances gen_instances.c -lm -lpthread
+
+#define GEN_CHUNK 65536     // cities per work item, part of the output definition (see above)
+#define GEN_AHEAD 4         // chunks per thread generated ahead of the writer at most
+#define GEN_ROAD_POINTS 64  // vertices of every road polyline
+#define GEN_TEXT_LINE 48    // longest "id x y penalty\n" line
+
+enum
+{
+    DIST_UNIFORM,
+    DIST_CLUSTER,
+    DIST_GRID,
+    DIST_ROAD
+};
+
+enum
+{
+    PENALTY_CONST,
+    PENALTY_UNIFORM,
+    PENALTY_EXP,
+    PENALTY_BIMODAL
+};
+
+typedef struct
+{
+    double x, y, sigma;
+} Cluster;
+
+typedef struct
+{
+    int n;
+    int dist;
+    int penalties;
+    int binary;
+    int size;      // coordinates are in [0, size)
+    int penalty;   // first line, and the mean of the per city penalties
+    uint64_t seed;
+    int clusters;  // clusters, or roads for DIST_ROAD
+    Cluster *centers;
+    double *road;  // DIST_ROAD: clusters * GEN_ROAD_POINTS vertices, x and y
+    int grid_side;
+
+    // work queue, chunks are handed out in order and written in order
+    int chunks;
+    int next_chunk;
+    int written;
+    int ahead;     // chunks allowed past written
+    char **out;    // finished chunk buffers, NULL until done
+    size_t *out_len;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} Generator;
+
+// splitmix64: seeds the chunk streams and is the generator itself
+static uint64_t next_u64(uint64_t *s)
+{
+    uint64_t z = (*s += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static double next_unit(uint64_t *s) // [0, 1)
+{
+    return (double)(next_u64(s) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int next_below(uint64_t *s, int bound)
+{
+    return (int)(next_u64(s) % (uint64_t)bound);
+}
+
+static double next_gauss(uint64_t *s) // Box-Muller
+{
+    double u = next_unit(s), v = next_unit(s);
+    return sqrt(-2.0 * log(1.0 - u)) * cos(2.0 * 3.14159265358979323846 * v);
+}
+
+static int clamp_coord(const Generator *g, double v)
+{
+    if (v < 0)
+        return 0;
+    if (v > g->size - 1)
+        return g->size - 1;
+    return (int)v;
+}
+
+// cluster centers and roads, from the seed alone
+static void gen_layout(Generator *g)
+{
+    uint64_t s = g->seed ^ 0xA5A5A5A5A5A5A5A5ULL;
+    if (g->dist == DIST_CLUSTER)
+    {
+        g->centers = malloc((size_t)g->clusters * sizeof(Cluster));
+        if (!g->centers)
+        {
+            fprintf(stderr, "Memory allocation failed for %d clusters.\n", g->clusters);
+            exit(1);
+        }
+        double base = g->size / (4.0 * sqrt((double)g->clusters));
+        for (int k = 0; k < g->clusters; k++)
+        {
+            g->centers[k].x = next_unit(&s) * g->size;
+            g->centers[k].y = next_unit(&s) * g->size;
+            g->centers[k].sigma = base * (0.25 + 1.5 * next_unit(&s));
+        }
+    }
+    else if (g->dist == DIST_ROAD)
+    {
+        // a road is a random walk with a slowly turning heading, bouncing off the borders
+        g->road = malloc((size_t)g->clusters * GEN_ROAD_POINTS * 2 * sizeof(double));
+        if (!g->road)
+        {
+            fprintf(stderr, "Memory allocation failed for %d roads.\n", g->clusters);
+            exit(1);
+        }
+        double step = g->size / 40.0;
+        for (int r = 0; r < g->clusters; r++)
+        {
+            double *v = g->road + (size_t)r * GEN_ROAD_POINTS * 2;
+            double x = next_unit(&s) * g->size, y = next_unit(&s) * g->size;
+            double heading = next_unit(&s) * 2.0 * 3.14159265358979323846;
+            for (int i = 0; i < GEN_ROAD_POINTS; i++)
+            {
+                v[2 * i] = x;
+                v[2 * i + 1] = y;
+                heading += 0.3 * next_gauss(&s);
+                x += step * cos(heading);
+                y += step * sin(heading);
+                if (x < 0 || x > g->size - 1)
+                {
+                    heading = 3.14159265358979323846 - heading;
+                    x = x < 0 ? -x : 2.0 * (g->size - 1) - x;
+                }
+                if (y < 0 || y > g->size - 1)
+                {
+                    heading = -heading;
+                    y = y < 0 ? -y : 2.0 * (g->size - 1) - y;
+                }
+            }
+        }
+    }
+    else if (g->dist == DIST_GRID)
+    {
+        g->grid_side = (int)ceil(sqrt((double)g->n));
+        if (g->grid_side < 1)
+            g->grid_side = 1;
+    }
+}
+
+// city i (0-based, id i + 1) from the chunk stream s into rec: id, x, y, penalty
+static void gen_city(const Generator *g, uint64_t *s, int i, int32_t *rec)
+{
+    double x, y;
+    switch (g->dist)
+    {
+    case DIST_CLUSTER:
+    {
+        const Cluster *c = &g->centers[next_below(s, g->clusters)];
+        x = c->x + c->sigma * next_gauss(s);
+        y = c->y + c->sigma * next_gauss(s);
+        break;
+    }
+    case DIST_GRID:
+    {
+        double spacing = (double)g->size / g->grid_side;
+        x = (i % g->grid_side) * spacing;
+        y = (i / g->grid_side) * spacing;
+        break;
+    }
+    case DIST_ROAD:
+    {
+        const double *v = g->road + (size_t)next_below(s, g->clusters) * GEN_ROAD_POINTS * 2;
+        int k = next_below(s, GEN_ROAD_POINTS - 1);
+        double t = next_unit(s), dx = v[2 * k + 2] - v[2 * k], dy = v[2 * k + 3] - v[2 * k + 1];
+        double len = sqrt(dx * dx + dy * dy), off = g->size / 2000.0 * next_gauss(s);
+        x = v[2 * k] + t * dx;
+        y = v[2 * k + 1] + t * dy;
+        if (len > 0) // sideways noise, perpendicular to the road
+        {
+            x -= off * dy / len;
+            y += off * dx / len;
+        }
+        break;
+    }
+    default:
+        x = next_below(s, g->size);
+        y = next_below(s, g->size);
+    }
+
+    double p;
+    switch (g->penalties)
+    {
+    case PENALTY_UNIFORM:
+        p = next_unit(s) * (2.0 * g->penalty + 1);
+        break;
+    case PENALTY_EXP:
+        p = -g->penalty * log(1.0 - next_unit(s));
+        break;
+    case PENALTY_BIMODAL:
+        p = next_unit(s) < 0.2 ? 3.0 * g->penalty : 0.5 * g->penalty;
+        break;
+    default:
+        p = g->penalty;
+    }
+    rec[0] = i + 1;
+    rec[1] = clamp_coord(g, x);
+    rec[2] = clamp_coord(g, y);
+    rec[3] = p < INT_MAX / 2 ? (int32_t)p : INT_MAX / 2;
+}
+
+// decimal of v at p, returns the end
+static char *put_int(char *p, int32_t v)
+{
+    char tmp[12];
+    int k = 0;
+    uint32_t u = v < 0 ? 0u - (uint32_t)v : (uint32_t)v;
+    do
+    {
+        tmp[k++] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u);
+    if (v < 0)
+        *p++ = '-';
+    while (k)
+        *p++ = tmp[--k];
+    return p;
+}
+
+// chunk k as text lines or binary records, malloc'ed
+static char *gen_chunk(const Generator *g, int k, size_t *len)
+{
+    int lo = k * GEN_CHUNK, hi = lo + GEN_CHUNK < g->n ? lo + GEN_CHUNK : g->n;
+    int per_city = g->penalties != PENALTY_CONST;
+    size_t fields = per_city ? 4 : 3;
+    char *buf = malloc((size_t)(hi - lo) * (g->binary ? fields * sizeof(int32_t) : GEN_TEXT_LINE) + 1);
+    if (!buf)
+    {
+        fprintf(stderr, "Memory allocation failed for chunk %d.\n", k);
+        exit(1);
+    }
+    uint64_t s = g->seed;
+    s = next_u64(&s) ^ (uint64_t)k * 0xD1B54A32D192ED03ULL; // stream of chunk k
+    char *p = buf;
+    for (int i = lo; i < hi; i++)
+    {
+        int32_t rec[4];
+        gen_city(g, &s, i, rec);
+        if (g->binary)
+        {
+            memcpy(p, rec, fields * sizeof(int32_t));
+            p += fields * sizeof(int32_t);
+            continue;
+        }
+        for (size_t f = 0; f < fields; f++)
+        {
+            p = put_int(p, rec[f]);
+            *p++ = f + 1 < fields ? ' ' : '\n';
+        }
+    }
+    *len = (size_t)(p - buf);
+    return buf;
+}
+
+static void *gen_worker(void *arg)
+{
+    Generator *g = arg;
+    for (;;)
+    {
+        pthread_mutex_lock(&g->lock);
+        while (g->next_chunk < g->chunks && g->next_chunk >= g->written + g->ahead)
+            pthread_cond_wait(&g->changed, &g->lock);
+        int k = g->next_chunk++;
+        pthread_mutex_unlock(&g->lock);
+        if (k >= g->chunks)
+            break;
+
+        size_t len;
+        char *buf = gen_chunk(g, k, &len);
+        pthread_mutex_lock(&g->lock);
+        g->out[k] = buf;
+        g->out_len[k] = len;
+        pthread_cond_broadcast(&g->changed);
+        pthread_mutex_unlock(&g->lock);
+    }
+    return NULL;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s <cities> <outputfile> [--dist uniform|cluster|grid|road] [--size S] [--clusters K]\n"
+                    "    [--penalty P] [--penalties const|uniform|exp|bimodal] [--seed N] [--threads N] [--binary]\n",
+            prog);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    Generator g;
+    memset(&g, 0, sizeof(g));
+    long long n = atoll(argv[1]);
+    const char *output = argv[2];
+    g.dist = DIST_UNIFORM;
+    g.penalties = PENALTY_CONST;
+    g.size = 100000; // same square as create_test_file.py
+    g.penalty = 1000;
+    g.seed = 1;
+    g.clusters = -1;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (n <= 0 || n > INT_MAX - GEN_CHUNK)
+    {
+        fprintf(stderr, "Invalid number of cities\n");
+        return 1;
+    }
+    g.n = (int)n;
+
+    for (int i = 3; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--dist") == 0 && i + 1 < argc)
+        {
+            const char *d = argv[++i];
+            if (strcmp(d, "uniform") == 0)
+                g.dist = DIST_UNIFORM;
+            else if (strcmp(d, "cluster") == 0)
+                g.dist = DIST_CLUSTER;
+            else if (strcmp(d, "grid") == 0)
+                g.dist = DIST_GRID;
+            else if (strcmp(d, "road") == 0)
+                g.dist = DIST_ROAD;
+            else
+            {
+                fprintf(stderr, "Invalid value for --dist (uniform, cluster, grid or road)\n");
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--penalties") == 0 && i + 1 < argc)
+        {
+            const char *p = argv[++i];
+            if (strcmp(p, "const") == 0)
+                g.penalties = PENALTY_CONST;
+            else if (strcmp(p, "uniform") == 0)
+                g.penalties = PENALTY_UNIFORM;
+            else if (strcmp(p, "exp") == 0)
+                g.penalties = PENALTY_EXP;
+            else if (strcmp(p, "bimodal") == 0)
+                g.penalties = PENALTY_BIMODAL;
+            else
+            {
+                fprintf(stderr, "Invalid value for --penalties (const, uniform, exp or bimodal)\n");
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+            g.size = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--clusters") == 0 && i + 1 < argc)
+            g.clusters = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--penalty") == 0 && i + 1 < argc)
+            g.penalty = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            g.seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--binary") == 0)
+            g.binary = 1;
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (g.size <= 0 || g.penalty < 0)
+    {
+        fprintf(stderr, "Invalid value for --size or --penalty\n");
+        return 1;
+    }
+    if (g.clusters <= 0) // default: about one cluster per 5000 cities, one road per 2000
+        g.clusters = g.dist == DIST_ROAD ? g.n / 2000 + 1 : g.n / 5000 + 1;
+    if (threads < 1)
+        threads = 1;
+
+    double t0 = now();
+    gen_layout(&g);
+    FILE *f = fopen(output, "wb");
+    if (!f)
+    {
+        perror("Could not open output file");
+        return 1;
+    }
+    if (g.binary)
+    {
+        TspbHeader h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, TSPB_MAGIC, 4);
+        h.version = TSPB_VERSION;
+        h.penalty = g.penalty;
+        h.flags = g.penalties != PENALTY_CONST ? TSPB_PER_CITY_PENALTY : 0;
+        h.count = g.n;
+        fwrite(&h, sizeof(h), 1, f);
+    }
+    else
+        fprintf(f, "%d\n", g.penalty);
+
+    g.chunks = (g.n + GEN_CHUNK - 1) / GEN_CHUNK;
+    g.ahead = threads * GEN_AHEAD;
+    g.out = calloc((size_t)g.chunks, sizeof(char *));
+    g.out_len = calloc((size_t)g.chunks, sizeof(size_t));
+    if (!g.out || !g.out_len)
+    {
+        fprintf(stderr, "Memory allocation failed for %d chunks.\n", g.chunks);
+        return 1;
+    }
+    pthread_mutex_init(&g.lock, NULL);
+    pthread_cond_init(&g.changed, NULL);
+    pthread_t *tids = malloc((size_t)threads * sizeof(pthread_t));
+    int started = 0;
+    for (int t = 0; tids && t < threads; t++)
+    {
+        if (pthread_create(&tids[t], NULL, gen_worker, &g) != 0)
+            break;
+        started++;
+    }
+    if (started == 0) // no threads at all, generate everything ahead on this one
+    {
+        g.ahead = g.chunks;
+        gen_worker(&g);
+    }
+
+    // writer: chunk k as soon as it is there
+    int failed = 0;
+    for (int k = 0; k < g.chunks; k++)
+    {
+        pthread_mutex_lock(&g.lock);
+        while (!g.out[k])
+            pthread_cond_wait(&g.changed, &g.lock);
+        pthread_mutex_unlock(&g.lock);
+        if (fwrite(g.out[k], 1, g.out_len[k], f) != g.out_len[k])
+            failed = 1;
+        free(g.out[k]);
+        pthread_mutex_lock(&g.lock);
+        g.out[k] = NULL;
+        g.written++;
+        pthread_cond_broadcast(&g.changed);
+        pthread_mutex_unlock(&g.lock);
+    }
+    for (int t = 0; t < started; t++)
+        pthread_join(tids[t], NULL);
+    if (fclose(f) != 0 || failed)
+    {
+        perror("Could not write output file");
+        return 1;
+    }
+    pthread_mutex_destroy(&g.lock);
+    pthread_cond_destroy(&g.changed);
+
+    printf("Wrote %d cities to %s in %.4f seconds\n", g.n, output, now() - t0);
+    free(tids);
+    free(g.out);
+    free(g.out_len);
+    free(g.centers);
+    free(g.road);
+    return 0;
+}
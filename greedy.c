@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tsp.h"
+
+// greedy edge construction: take candidate edges shortest first and keep one whenever both ends still
+// have a free slot and it does not close a cycle (union-find). that leaves a set of paths, which are
+// joined end to end by nearest neighbour search over the path ends. greedy tours are usually 15-20%
+// above optimal against 25% or more for the Morton order, so 2-opt has less to fix.
+// every city ends up on the tour, pruning decides the skips afterwards like for the Morton order.
+
+typedef struct
+{
+    int len;
+    int u, v;
+} Edge;
+
+static int compare_edges(const void *a, const void *b)
+{
+    const Edge *x = a, *y = b;
+    return (x->len > y->len) - (x->len < y->len);
+}
+
+static int find_root(int *parent, int c)
+{
+    while (parent[c] != c)
+    {
+        parent[c] = parent[parent[c]]; // path halving
+        c = parent[c];
+    }
+    return c;
+}
+
+// builds a tour through all n cities from the edges of cg into tour, returns n and starts the cost
+// bookkeeping of ctx
+int construct_greedy(SolverContext *ctx, const City *cities, int n, const CandidateGraph *cg, int *tour)
+{
+    if (n <= 3)
+    {
+        for (int i = 0; i < n; i++)
+            tour[i] = i;
+        solver_set_tour(ctx, cities, tour, n, n);
+        return n;
+    }
+
+    ArenaMark mark = arena_mark(&ctx->arena);
+    int m = 0;
+    for (int c = 0; c < n; c++)
+        for (int e = cg->start[c]; e < cg->start[c + 1]; e++)
+            if (c < cg->adj[e])
+                m++;
+    Edge *edges = arena_alloc(&ctx->arena, (size_t)m * sizeof(Edge) + sizeof(Edge));
+    m = 0;
+    for (int c = 0; c < n; c++)
+        for (int e = cg->start[c]; e < cg->start[c + 1]; e++)
+            if (c < cg->adj[e])
+            {
+                edges[m].len = metric_distance(ctx->metric, &cities[c], &cities[cg->adj[e]]);
+                edges[m].u = c;
+                edges[m].v = cg->adj[e];
+                m++;
+            }
+    qsort(edges, (size_t)m, sizeof(Edge), compare_edges);
+
+    int *link = arena_alloc(&ctx->arena, (size_t)2 * n * sizeof(int)); // up to two tour neighbours per city
+    int *parent = arena_alloc(&ctx->arena, (size_t)n * sizeof(int));
+    memset(link, -1, (size_t)2 * n * sizeof(int));
+    for (int c = 0; c < n; c++)
+        parent[c] = c;
+    int taken = 0;
+    for (int i = 0; i < m && taken < n - 1; i++)
+    {
+        int u = edges[i].u, v = edges[i].v;
+        if (link[2 * u + 1] >= 0 || link[2 * v + 1] >= 0)
+            continue; // degree 2 already
+        int ru = find_root(parent, u), rv = find_root(parent, v);
+        if (ru == rv)
+            continue; // would close a cycle
+        parent[ru] = rv;
+        link[2 * u + (link[2 * u] >= 0)] = v;
+        link[2 * v + (link[2 * v] >= 0)] = u;
+        taken++;
+    }
+
+    // join the paths: walk one to its far end, continue with the nearest end of a path not walked yet
+    // path ends (cities with a free slot) go into a grid; if the nearest ends are all used, fall back to
+    // the next unused end in Morton order
+    GridIndex g;
+    grid_init(&g, &ctx->arena, cities, n, 2);
+    for (int c = 0; c < n; c++)
+        if (link[2 * c + 1] < 0)
+            grid_insert(&g, cities, c);
+    char *used = ctx->marks;
+    memset(used, 0, (size_t)n);
+
+    int size = 0, cursor = 0, start = -1;
+    for (int c = 0; c < n && start < 0; c++)
+        if (link[2 * c + 1] < 0)
+            start = c;
+    while (start >= 0)
+    {
+        int prev = -1, c = start;
+        while (c >= 0)
+        {
+            tour[size++] = c;
+            used[c] = 1;
+            int nx = link[2 * c];
+            if (nx == prev || nx < 0)
+                nx = link[2 * c + 1];
+            if (nx == prev)
+                nx = -1;
+            prev = c;
+            c = nx;
+        }
+
+        start = -1;
+        int near[GRID_MAX_K];
+        int found = grid_nearest(&g, cities, &cities[prev], prev, GRID_MAX_K, 0, near);
+        for (int i = 0; i < found && start < 0; i++)
+            if (!used[near[i]])
+                start = near[i];
+        while (start < 0 && cursor < n)
+        {
+            if (!used[cursor] && link[2 * cursor + 1] < 0)
+                start = cursor;
+            cursor++;
+        }
+    }
+    if (ctx->verbose)
+        printf("Greedy edges: %d of %d candidate edges taken, %d paths joined\n", taken, m, n - taken);
+
+    arena_release(&ctx->arena, mark);
+    solver_set_tour(ctx, cities, tour, size, n);
+    return size;
+}
@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "tsp.h"
+
+// uniform grid over the bounding box of the cities, a few cities per cell
+// cities are added one by one (e.g. as they join the tour), each cell keeps a linked list of its cities
+// so nearest-neighbour queries only ever look at cities that were inserted
+
+void grid_init(GridIndex *g, Arena *arena, const City *cities, int n, int per_cell)
+{
+    int min_x = 0, max_x = 0, min_y = 0, max_y = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (i == 0 || cities[i].x < min_x)
+            min_x = cities[i].x;
+        if (i == 0 || cities[i].x > max_x)
+            max_x = cities[i].x;
+        if (i == 0 || cities[i].y < min_y)
+            min_y = cities[i].y;
+        if (i == 0 || cities[i].y > max_y)
+            max_y = cities[i].y;
+    }
+    double w = (double)(max_x - min_x) + 1, h = (double)(max_y - min_y) + 1;
+    double cells = (double)n / (per_cell > 0 ? per_cell : 2) + 1;
+    double side = sqrt(w * h / cells); // square cells
+    if (side < 1)
+        side = 1;
+
+    g->min_x = min_x;
+    g->min_y = min_y;
+    g->cell = side;
+    g->cols = (int)(w / side) + 1;
+    g->rows = (int)(h / side) + 1;
+    g->head = arena_alloc(arena, (size_t)g->cols * g->rows * sizeof(int));
+    g->next = arena_alloc(arena, (size_t)n * sizeof(int));
+    memset(g->head, -1, (size_t)g->cols * g->rows * sizeof(int));
+}
+
+static void grid_cell_of(const GridIndex *g, int x, int y, int *cx, int *cy)
+{
+    int c = (int)((x - g->min_x) / g->cell);
+    int r = (int)((y - g->min_y) / g->cell);
+    *cx = c < 0 ? 0 : (c >= g->cols ? g->cols - 1 : c);
+    *cy = r < 0 ? 0 : (r >= g->rows ? g->rows - 1 : r);
+}
+
+void grid_insert(GridIndex *g, const City *cities, int c)
+{
+    int cx, cy;
+    grid_cell_of(g, cities[c].x, cities[c].y, &cx, &cy);
+    int cell = cy * g->cols + cx;
+    g->next[c] = g->head[cell];
+    g->head[cell] = c;
+}
+
+// up to k inserted cities nearest to p (excluding city `self`, pass -1 for none), closest first
+// rings of cells are searched outwards until nothing closer can be found; if max_dist > 0 the search
+// gives up past that distance when nothing was found yet
+int grid_nearest(const GridIndex *g, const City *cities, const City *p, int self, int k, int max_dist, int *out)
+{
+    long long best_d2[GRID_MAX_K];
+    int found = 0;
+    if (k > GRID_MAX_K)
+        k = GRID_MAX_K;
+    if (k <= 0)
+        return 0; // e.g. asked for the n-1 others of a single city
+
+    int cx, cy;
+    grid_cell_of(g, p->x, p->y, &cx, &cy);
+    int max_r = g->cols > g->rows ? g->cols : g->rows;
+    for (int r = 0; r <= max_r; r++)
+    {
+        for (int y = cy - r; y <= cy + r; y++)
+        {
+            if (y < 0 || y >= g->rows)
+                continue;
+            int step = (y == cy - r || y == cy + r) ? 1 : 2 * r; // inside rows only the two border cells
+            for (int x = cx - r; x <= cx + r; x += step)
+            {
+                if (x < 0 || x >= g->cols)
+                    continue;
+                for (int c = g->head[y * g->cols + x]; c != -1; c = g->next[c])
+                {
+                    if (c == self)
+                        continue;
+                    long long dx = cities[c].x - p->x, dy = cities[c].y - p->y;
+                    long long d2 = dx * dx + dy * dy;
+                    if (found == k && d2 >= best_d2[k - 1])
+                        continue;
+                    // insertion into the sorted candidate list
+                    int pos = found < k ? found++ : k - 1;
+                    while (pos > 0 && best_d2[pos - 1] > d2)
+                    {
+                        best_d2[pos] = best_d2[pos - 1];
+                        out[pos] = out[pos - 1];
+                        pos--;
+                    }
+                    best_d2[pos] = d2;
+                    out[pos] = c;
+                }
+            }
+        }
+        // everything outside ring r is at least r cells away
+        double reach = r * g->cell;
+        if (found == k && (double)best_d2[k - 1] <= reach * reach)
+            break;
+        if (found == 0 && max_dist > 0 && reach > max_dist)
+            break;
+    }
+    return found;
+}
+
+// k nearest neighbours (in the plane) of every city as a candidate graph, each list sorted closest first by metric
+void build_knn_candidates(Arena *arena, int metric, const City *cities, int n, int k, CandidateGraph *cg)
+{
+    if (k > GRID_MAX_K)
+        k = GRID_MAX_K;
+    if (k > n - 1)
+        k = n - 1 > 0 ? n - 1 : 0;
+    cg->start = arena_alloc(arena, (size_t)(n + 1) * sizeof(int));
+    cg->adj = arena_alloc(arena, (size_t)n * k * sizeof(int) + sizeof(int));
+    if (k <= 0) // a single city (or none) has no neighbours
+    {
+        memset(cg->start, 0, (size_t)(n + 1) * sizeof(int));
+        return;
+    }
+
+    ArenaMark mark = arena_mark(arena);
+    GridIndex g;
+    grid_init(&g, arena, cities, n, 2);
+    for (int c = 0; c < n; c++)
+        grid_insert(&g, cities, c);
+    int m = 0;
+    for (int c = 0; c < n; c++)
+    {
+        cg->start[c] = m;
+        int found = grid_nearest(&g, cities, &cities[c], c, k, 0, cg->adj + m);
+        sort_candidates(metric, cities, c, cg->adj + m, found); // nearest in the plane, ordered by the metric
+        m += found;
+    }
+    cg->start[n] = m;
+    arena_release(arena, mark); // the grid itself is not needed any more
+}
@@ -0,0 +1,241 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tsp.h"
+
+// penalty-aware cheapest insertion: instead of building a tour through every city and pruning later,
+// grow the tour by cheapest insertion and only let a city in if it is worth more than its own penalty.
+// the rest stay in the skipped pool, so the 2-opt that follows only sees cities that matter.
+// a city's insertion cost into a half built tour says little (the first cities always look expensive),
+// so the decision is made in two steps:
+//   1. estimate what a city would cost on a complete tour from its two nearest neighbours among all
+//      cities, d(a,c) + d(c,b) - d(a,b), and insert the ones below the penalty
+//   2. retry the rest against the tour from step 1 and insert them if the real cost is below the penalty
+// candidate places are the edges next to the nearest cities already on the tour, found with the grid,
+// or taken from the candidate graph when the pipeline built one (the grid stays the fallback for cities
+// none of whose candidates are on the tour yet).
+
+#define INSERTION_NEIGHBORS 8
+#define INSERTION_PASSES 3 // skipped cities get retried while the tour fills in around them
+
+// cheapest edge (a, next[a]) to put c on, among the edges touching the tour cities nearest to c
+// returns the insertion cost, *after receives a
+static long long cheapest_edge(int metric, const City *cities, const GridIndex *g, const CandidateGraph *cg, const int *next, const int *prev, int c, int max_dist, int *after)
+{
+    int near[INSERTION_NEIGHBORS];
+    int found = 0;
+    if (cg)
+        for (int e = cg->start[c]; e < cg->start[c + 1] && found < INSERTION_NEIGHBORS; e++)
+            if (next[cg->adj[e]] >= 0) // on the tour
+                near[found++] = cg->adj[e];
+    if (found == 0)
+        found = grid_nearest(g, cities, &cities[c], c, INSERTION_NEIGHBORS, max_dist, near);
+    long long best = -1;
+    for (int i = 0; i < found; i++)
+    {
+        int m = near[i];
+        int ends[2] = {m, prev[m]}; // both edges touching m
+        for (int e = 0; e < 2; e++)
+        {
+            int a = ends[e], b = next[a];
+            long long cost = (long long)metric_distance(metric, &cities[a], &cities[c]) + metric_distance(metric, &cities[c], &cities[b]) - metric_distance(metric, &cities[a], &cities[b]);
+            if (best < 0 || cost < best)
+            {
+                best = cost;
+                *after = a;
+            }
+        }
+    }
+    return best;
+}
+
+// tour under construction: a doubly linked cycle, plus a grid of the cities on it
+typedef struct
+{
+    int *next, *prev; // -1: not on the tour
+    GridIndex g;
+    int size;
+    unsigned long long len;
+} LinkedTour;
+
+static void linked_init(SolverContext *ctx, const City *cities, int n, LinkedTour *t)
+{
+    t->next = arena_alloc(&ctx->arena, (size_t)n * sizeof(int));
+    t->prev = arena_alloc(&ctx->arena, (size_t)n * sizeof(int));
+    memset(t->next, -1, (size_t)n * sizeof(int));
+    grid_init(&t->g, &ctx->arena, cities, n, 2);
+    t->size = 0;
+    t->len = 0;
+}
+
+// c goes between a and next[a] (a < 0: c is the first city, a loop onto itself)
+static void linked_insert(const City *cities, LinkedTour *t, int a, int c, long long cost)
+{
+    if (a < 0)
+        a = c;
+    int b = a == c ? c : t->next[a];
+    t->next[a] = c;
+    t->prev[c] = a;
+    t->next[c] = b;
+    t->prev[b] = c;
+    grid_insert(&t->g, cities, c);
+    t->len += (unsigned long long)cost;
+    t->size++;
+}
+
+// step 2: the pool against the real tour, only where it pays for itself
+// inserted cities and their new neighbours go to seeds (if not NULL), returns the cities left in the pool
+static int insert_pool(SolverContext *ctx, const City *cities, const CandidateGraph *cg, LinkedTour *t, int *pool, int pool_size, int *seeds, int *seed_count)
+{
+    for (int pass = 0; pass < INSERTION_PASSES && pool_size > 0; pass++)
+    {
+        int kept = 0, inserted = 0;
+        for (int i = 0; i < pool_size; i++)
+        {
+            int c = pool[i], a = -1;
+            long long cost = cheapest_edge(ctx->metric, cities, &t->g, cg, t->next, t->prev, c, cities[c].penalty, &a);
+            if (cost >= 0 && cost < cities[c].penalty)
+            {
+                linked_insert(cities, t, a, c, cost);
+                inserted++;
+                if (seeds)
+                {
+                    seeds[(*seed_count)++] = a;
+                    seeds[(*seed_count)++] = c;
+                    seeds[(*seed_count)++] = t->next[c];
+                }
+            }
+            else
+                pool[kept++] = c;
+        }
+        if (ctx->verbose)
+            printf("Insertion pass %d: %d inserted, %d skipped\n", pass, inserted, kept);
+        pool_size = kept;
+        if (inserted == 0)
+            break;
+    }
+    return pool_size;
+}
+
+// flatten the linked tour into tour starting from first, and hand the cost over to ctx
+static int linked_flatten(SolverContext *ctx, const City *cities, int n, const LinkedTour *t, int first, int *tour)
+{
+    int c = first;
+    for (int i = 0; i < t->size; i++)
+    {
+        tour[i] = c;
+        c = t->next[c];
+    }
+    ctx->tour_len = t->len;
+    ctx->skipped = n - t->size;
+    ctx->total_cities = n;
+    ctx->skip_cost = 0;
+    for (c = 0; c < n; c++)
+        if (t->next[c] < 0)
+            ctx->skip_cost += (unsigned long long)cities[c].penalty;
+    CHECK_COST(ctx, cities, tour, t->size, "insertion");
+    return t->size;
+}
+
+// builds the tour over cities (expected in Morton order, see solve_instance) into tour
+// returns the number of cities on it and starts the cost bookkeeping of ctx
+// cg may be NULL
+int construct_insertion(SolverContext *ctx, const City *cities, int n, const CandidateGraph *cg, int *tour)
+{
+    if (n <= 0)
+    {
+        solver_set_tour(ctx, cities, tour, 0, n);
+        return 0;
+    }
+
+    ArenaMark mark = arena_mark(&ctx->arena);
+    LinkedTour t;
+    linked_init(ctx, cities, n, &t);
+    int *pool = ctx->scratch; // cities still waiting for a place
+
+    // step 1: likely tour members by their neighbourhood, everything else goes to the pool
+    // the first two candidates are as good as the two nearest cities here
+    GridIndex all;
+    if (!cg)
+    {
+        grid_init(&all, &ctx->arena, cities, n, 2);
+        for (int c = 0; c < n; c++)
+            grid_insert(&all, cities, c);
+    }
+    int pool_size = 0, members = 0;
+    for (int c = 0; c < n; c++)
+    {
+        int near[2];
+        int found;
+        if (cg)
+        {
+            found = cg->start[c + 1] - cg->start[c] < 2 ? cg->start[c + 1] - cg->start[c] : 2;
+            for (int i = 0; i < found; i++)
+                near[i] = cg->adj[cg->start[c] + i];
+        }
+        else
+            found = grid_nearest(&all, cities, &cities[c], c, 2, 0, near);
+        long long est = 0;
+        if (found == 2)
+            est = (long long)metric_distance(ctx->metric, &cities[near[0]], &cities[c]) + metric_distance(ctx->metric, &cities[c], &cities[near[1]]) - metric_distance(ctx->metric, &cities[near[0]], &cities[near[1]]);
+        if (est < cities[c].penalty)
+            tour[members++] = c; // tour is free until the end, use it as the member list
+        else
+            pool[pool_size++] = c;
+    }
+    if (members == 0) // nothing worth a visit, the tour still needs one city to start from
+        tour[members++] = pool[--pool_size];
+
+    // start from the first member, a tour of one city is a loop onto itself
+    int first = tour[0];
+    linked_insert(cities, &t, -1, first, 0);
+    for (int i = 1; i < members; i++)
+    {
+        int c = tour[i], a = first;
+        long long cost = cheapest_edge(ctx->metric, cities, &t.g, cg, t.next, t.prev, c, 0, &a);
+        linked_insert(cities, &t, a, c, cost);
+    }
+    if (ctx->verbose)
+        printf("Insertion: %d likely members inserted, %d cities in the pool\n", members, pool_size);
+
+    insert_pool(ctx, cities, cg, &t, pool, pool_size, NULL, NULL);
+    int size = linked_flatten(ctx, cities, n, &t, first, tour);
+    arena_release(&ctx->arena, mark);
+    return size;
+}
+
+// warm start: tour[0..tour_size) is kept as it is, the cities not on it are inserted where that costs
+// less than their penalty, like step 2 above. every inserted city and its two new neighbours are added to
+// seeds (room for 3 per city needed); returns the new tour size, the cost bookkeeping is restarted
+int insert_missing(SolverContext *ctx, const City *cities, int n, const CandidateGraph *cg, int *tour, int tour_size, int *seeds, int *seed_count)
+{
+    if (n <= 0)
+    {
+        solver_set_tour(ctx, cities, tour, 0, n);
+        return 0;
+    }
+
+    ArenaMark mark = arena_mark(&ctx->arena);
+    LinkedTour t;
+    linked_init(ctx, cities, n, &t);
+    for (int i = 0; i < tour_size; i++)
+        linked_insert(cities, &t, i == 0 ? -1 : tour[i - 1], tour[i], 0);
+    t.len = tour_length_metric(ctx->metric, cities, tour, tour_size);
+
+    int *pool = ctx->scratch, pool_size = 0;
+    for (int c = 0; c < n; c++)
+        if (t.next[c] < 0)
+            pool[pool_size++] = c;
+    if (t.size == 0) // the old tour is gone altogether, start from any city
+    {
+        linked_insert(cities, &t, -1, pool[--pool_size], 0);
+        seeds[(*seed_count)++] = tour[0] = pool[pool_size];
+    }
+    if (ctx->verbose)
+        printf("Insertion: %d cities on the tour, %d to try to insert\n", t.size, pool_size);
+
+    insert_pool(ctx, cities, cg, &t, pool, pool_size, seeds, seed_count);
+    int size = linked_flatten(ctx, cities, n, &t, tour[0], tour);
+    arena_release(&ctx->arena, mark);
+    return size;
+}
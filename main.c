@@ -1,23 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "city.h"
-#include <math.h>
-#include <stdint.h>
 #include <time.h>
+#include <unistd.h>
+#include "tsp.h"
 
-#define MAX_LINE 100
-#define DEFAULT_MAX_CITIES 5000
-
-int read_input(const char *filename, int *penalty, City *cities);
-int compare_morton(const void *a, const void *b);
-uint64_t morton_code(int x, int y);
-int distance(const City *a, const City *b);
-void two_opt_random_regions(City *cities, int *tour, int n, int window, int K);
-void two_opt_local(City *cities, int *tour, int n, int window);
-void two_opt(City *cities, int *tour, int n);
-int tour_length(const City *cities, const int *tour, int n);
-int prune_tour(City *cities, int *tour, int *tour_size, int penalty);
+// command line front end of the solver
+// compile option -- gcc -O2 -o tsp_with_penalty main.c tsp.c batch.c grid.c insertion.c decompose.c multilevel.c delaunay.c greedy.c tsplib.c warmstart.c sweep.c checkpoint.c -lm -lpthread
 
 int main(int argc, char *argv[])
 {
@@ -26,137 +15,241 @@ int main(int argc, char *argv[])
     int penalty;
     int max_cities = DEFAULT_MAX_CITIES;
     char *input_file = NULL;
+    const char *output_file = "output.txt";
+    const char *batch_manifest = NULL;
+    const char *warm_start = NULL;
+    const char *sweep = NULL;
+    const char *checkpoint = NULL;
+    const char *resume = NULL;
+    double checkpoint_interval = 30;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    SolveOptions opt;
+    default_solve_options(&opt);
+    opt.verbose = 1;
 
     // Parse arguments
-    if (argc < 2)
-    {
-        fprintf(stderr, "Usage: %s <inputfile> [--maxCities N]\n", argv[0]);
-        return 1;
-    }
-    input_file = argv[1];
-    if (argc >= 4 && strcmp(argv[2], "--maxCities") == 0)
+    for (int i = 1; i < argc; i++)
     {
-        max_cities = atoi(argv[3]);
-        if (max_cities <= 0)
+        if (strcmp(argv[i], "--maxCities") == 0 && i + 1 < argc)
+        {
+            max_cities = atoi(argv[++i]);
+            if (max_cities <= 0)
+            {
+                fprintf(stderr, "Invalid value for --maxCities\n");
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--timeLimit") == 0 && i + 1 < argc)
+            opt.time_limit = atof(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            opt.seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            output_file = argv[++i];
+        else if (strcmp(argv[i], "--construct") == 0 && i + 1 < argc)
+        {
+            const char *how = argv[++i];
+            if (strcmp(how, "insertion") == 0)
+                opt.construct = CONSTRUCT_INSERTION;
+            else if (strcmp(how, "morton") == 0)
+                opt.construct = CONSTRUCT_MORTON;
+            else if (strcmp(how, "greedy") == 0)
+                opt.construct = CONSTRUCT_GREEDY;
+            else
+            {
+                fprintf(stderr, "Invalid value for --construct (morton, insertion or greedy)\n");
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--candidates") == 0 && i + 1 < argc)
         {
-            fprintf(stderr, "Invalid value for --maxCities\n");
+            const char *kind = argv[++i];
+            if (strcmp(kind, "delaunay") == 0)
+                opt.candidates = CANDIDATES_DELAUNAY;
+            else if (strcmp(kind, "knn") == 0)
+                opt.candidates = CANDIDATES_KNN;
+            else if (strcmp(kind, "window") == 0)
+                opt.candidates = CANDIDATES_WINDOW;
+            else
+            {
+                fprintf(stderr, "Invalid value for --candidates (window, knn or delaunay)\n");
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--decompose") == 0)
+            opt.decompose = 1;
+        else if (strcmp(argv[i], "--multilevel") == 0)
+            opt.multilevel = 1;
+        else if (strcmp(argv[i], "--clusterSize") == 0 && i + 1 < argc)
+        {
+            opt.cluster_size = atoi(argv[++i]);
+            if (opt.cluster_size <= 0)
+            {
+                fprintf(stderr, "Invalid value for --clusterSize\n");
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--warm-start") == 0 && i + 1 < argc)
+            warm_start = argv[++i];
+        else if (strcmp(argv[i], "--sweep") == 0 && i + 1 < argc)
+            sweep = argv[++i];
+        else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc)
+            checkpoint = argv[++i];
+        else if (strcmp(argv[i], "--checkpointInterval") == 0 && i + 1 < argc)
+        {
+            checkpoint_interval = atof(argv[++i]);
+            if (checkpoint_interval <= 0)
+            {
+                fprintf(stderr, "Invalid value for --checkpointInterval\n");
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--resume") == 0 && i + 1 < argc)
+            resume = argv[++i];
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+            batch_manifest = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (argv[i][0] != '-' && !input_file)
+            input_file = argv[i];
+        else
+        {
+            fprintf(stderr, "Unknown argument: %s\n", argv[i]);
             return 1;
         }
     }
 
-    // Now allocate city array using max_cities
-    City cities[max_cities]; // if there are too many cities like 1 million the stack will be to small for this array and we will need to use malloc
-    if (!cities)
+    opt.threads = threads;
+    if (opt.multilevel && opt.construct != CONSTRUCT_MORTON)
     {
-        fprintf(stderr, "Failed to allocate memory for %d cities.\n", max_cities);
+        fprintf(stderr, "--construct insertion and greedy do not work with --multilevel (its coarsest level starts in Morton order)\n");
         return 1;
     }
-
-    int n = read_input(input_file, &penalty, cities);
-    if (n > max_cities)
+    if ((checkpoint || resume) && (batch_manifest || warm_start || sweep || opt.multilevel || opt.decompose))
     {
-        fprintf(stderr, "Input file has %d cities, but max allowed is %d.\n", n, max_cities);
-        n = max_cities;
+        fprintf(stderr, "--checkpoint and --resume only work with the default pipeline (not with --batch, --warm-start, --sweep, --multilevel or --decompose)\n");
+        return 1;
     }
-
-    // Find morton codes and sort the cities for good estimate of initial tour
-    // Step 1: Find min and max for x and y
-    int min_x = cities[0].x, max_x = cities[0].x;
-    int min_y = cities[0].y, max_y = cities[0].y;
-    for (int i = 1; i < n; i++)
+    if (batch_manifest)
     {
-        if (cities[i].x < min_x)
-            min_x = cities[i].x;
-        if (cities[i].x > max_x)
-            max_x = cities[i].x;
-        if (cities[i].y < min_y)
-            min_y = cities[i].y;
-        if (cities[i].y > max_y)
-            max_y = cities[i].y;
+        // manifest of "<inputfile> [outputfile]" lines, - reads it from stdin
+        FILE *manifest = strcmp(batch_manifest, "-") == 0 ? stdin : fopen(batch_manifest, "r");
+        if (!manifest)
+        {
+            perror("Could not open batch manifest");
+            return 1;
+        }
+        int rc = run_batch(manifest, threads, &opt);
+        if (manifest != stdin)
+            fclose(manifest);
+        return rc == 0 ? 0 : 1;
     }
 
-    // Step 2: Map all coordinates to [0,65535] and assign Morton codes
-    for (int i = 0; i < n; i++)
+    if (!input_file)
     {
-        int x_mapped = (max_x == min_x) ? 0 : (int)(((cities[i].x - min_x) * 65535.0) / (max_x - min_x));
-        int y_mapped = (max_y == min_y) ? 0 : (int)(((cities[i].y - min_y) * 65535.0) / (max_y - min_y));
-        cities[i].morton = morton_code(x_mapped, y_mapped);
+        fprintf(stderr, "Usage: %s <inputfile> [--maxCities N] [--timeLimit S] [--seed N] [--output FILE] [--construct morton|insertion|greedy]\n"
+                        "       [--candidates window|knn|delaunay] [--decompose] [--clusterSize N] [--threads N] [--multilevel]\n"
+                        "       [--warm-start TOURFILE] [--sweep P1,P2,...|LO:HI:STEP]\n"
+                        "       [--checkpoint FILE] [--checkpointInterval S] [--resume FILE]\n", argv[0]);
+        fprintf(stderr, "       %s --batch <manifest|-> [--threads N] [--timeLimit S] [--seed N] [--construct morton|insertion|greedy]\n"
+                        "       [--candidates window|knn|delaunay]\n", argv[0]);
+        return 1;
     }
 
-    // assume initalized tour holds the order of morton order, it has nothing do with ids of the cities
-    int tour[max_cities];
-    for (int i = 0; i < n; i++)
-        tour[i] = i;
-
-    printf("Initial tour length (Morton order): %d\n", tour_length(cities, tour, n));
-
-    // Choose 2-opt version based on the input size: 2-opt might blow the execution time if not restricted
-    // espicially for large input sizes, the choise of doing partial 2-opt thereof
-
-    if (n <= 5000)
-    {
-        printf("Running full 2-opt...\n");
-        two_opt(cities, tour, n);
-    }
-    else if (n <= 20000)
+    // Now allocate city array using max_cities
+    City *cities = malloc(max_cities * sizeof(City));
+    int *tour = malloc(max_cities * sizeof(int));
+    if (!cities || !tour)
     {
-        printf("Running local 2-opt with window 500...\n");
-        two_opt_local(cities, tour, n, 500); // windows can change based on the further tests
+        fprintf(stderr, "Failed to allocate memory for %d cities.\n", max_cities);
+        return 1;
     }
-    else
+
+    size_t len;
+    char *buf = read_file(input_file, &len);
+    if (!buf)
+        return 1;
+    int n = parse_instance(buf, len, &penalty, &opt.metric, cities, max_cities); // our text or binary format, or TSPLIB
+    free(buf);
+    if (n < 0)
+        return 1;
+    if (n > max_cities)
     {
-        printf("Running random-region 2-opt: 1000 regions, window 1000...\n");
-        two_opt_random_regions(cities, tour, n, 1000, 1000); // randomness factor, region number and windows may be changed based on further tests
+        fprintf(stderr, "Input file has %d cities, but max allowed is %d.\n", n, max_cities);
+        n = max_cities;
     }
 
-    printf("Improved tour length (after 2-opt): %d\n", tour_length(cities, tour, n));
-
-    printf("Tour order (city IDs):\n");
-    for (int i = 0; i < n; i++)
-        printf("%d ", cities[tour[i]].id);
-    printf("\n");
-
-    // try to prune the tour if possible
-    // number of prunes could be changed after some tests to optimize exectuion time over corerctness
-
-    int tour_size = n;
+    // all scratch buffers for the optimization phases come from here, sized once from n
+    SolverContext ctx;
+    if (solver_context_init(&ctx, n) != 0)
+        return 1;
 
-    if (n <= 5000)
+    if (sweep)
     {
-        printf("Pruning 3 times...\n");
-        for (int i = 0; i < 3; i++)
-            prune_tour(cities, tour, &tour_size, penalty);
-        two_opt(cities, tour, n); // 2-opt again after pruning - this could also be changed since full 2-opt makes code slower
-        // you may one to just make local 2-opt after pruning to cut down execution time or not do it at all
+        // same cities at many penalties (the one in the file is not used), see sweep.c
+        int *penalties = NULL;
+        int count = parse_penalty_list(sweep, &penalties);
+        if (count <= 0)
+        {
+            fprintf(stderr, "Invalid value for --sweep (P1,P2,... or LO:HI:STEP)\n");
+            return 1;
+        }
+        int rc = run_sweep(&ctx, &opt, cities, n, penalties, count, output_file);
+        free(penalties);
+        free(cities);
+        free(tour);
+        solver_context_free(&ctx);
+        printf("Execution time: %.8f seconds\n", (double)(clock() - start) / CLOCKS_PER_SEC);
+        return rc == 0 ? 0 : 1;
     }
-    else if (n <= 20000)
+
+    int tour_size;
+    if (warm_start)
     {
-        printf("Pruning 3 times...\n");
-        for (int i = 0; i < 3; i++)
-            prune_tour(cities, tour, &tour_size, penalty);
-        two_opt_local(cities, tour, n, 500); // this is 2-opt after pruning
-        // 2-opt window number of times or method of 2-opt full, local, random may change to better utilize execution time
+        // continue from the tour of a previous run (write_output format), see warmstart.c
+        int prev_count;
+        int *prev_ids = read_tour(warm_start, &prev_count);
+        if (!prev_ids)
+            return 1;
+        solve_warm_start(&ctx, &opt, cities, n, prev_ids, prev_count, tour, &tour_size);
+        free(prev_ids);
     }
     else
     {
-        printf("Pruning 3 times...\n");
-        for (int i = 0; i < 3; i++)
-            prune_tour(cities, tour, &tour_size, penalty);
-        two_opt_random_regions(cities, tour, n, 1000, 1000); // further tests needed for better number of pruning or option of 2-opt based on execution time
+        // periodic snapshots of the run, and/or carry on from the snapshot of an earlier one, see checkpoint.c
+        if (checkpoint)
+        {
+            ctx.checkpoint = checkpoint_start(checkpoint, checkpoint_interval, cities, n);
+            if (!ctx.checkpoint)
+                return 1;
+        }
+        if (resume)
+        {
+            SolverProgress from;
+            int count;
+            int *ids = checkpoint_load(resume, &opt, cities, n, &from, &count);
+            if (!ids)
+                return 1;
+            solve_resume(&ctx, &opt, cities, n, &from, ids, count, tour, &tour_size);
+            free(ids);
+        }
+        else
+            solve_instance(&ctx, &opt, cities, n, tour, &tour_size);
+        if (checkpoint_finish(ctx.checkpoint, &ctx, tour, tour_size) != 0)
+            fprintf(stderr, "Some checkpoints could not be written\n");
     }
 
-    // Final cost calculations
-    int final_tour_length = tour_length(cities, tour, tour_size);
-    int skipped = n - tour_size;
-    int penalty_cost = skipped * penalty;
-    int total_cost = final_tour_length + penalty_cost;
+    // running values from the solver state, no need to walk the tour again
+    unsigned long long final_tour_length = ctx.tour_len;
+    int skipped = ctx.skipped;
+    unsigned long long penalty_cost = ctx.skip_cost;
+    unsigned long long total_cost = solver_total_cost(&ctx);
 
     printf("Final tour after pruning and 2-opt:\n");
     printf("  Cities visited : %d\n", tour_size);
     printf("  Skipped cities : %d\n", skipped);
-    printf("  Penalty cost   : %d\n", penalty_cost);
-    printf("  Tour length    : %d\n", final_tour_length);
-    printf("  Total cost     : %d\n", total_cost);
+    printf("  Penalty cost   : %llu\n", penalty_cost);
+    printf("  Tour length    : %llu\n", final_tour_length);
+    printf("  Total cost     : %llu\n", total_cost);
 
     printf("Tour order (city IDs):\n");
     for (int i = 0; i < tour_size; i++)
@@ -165,18 +258,12 @@ int main(int argc, char *argv[])
 
     // === WRITING TO OUTPUTFILE ===
 
-    FILE *fout = fopen("output.txt", "w");
-    if (!fout)
-    {
-        perror("Could not open output file");
+    if (write_output(output_file, cities, tour, tour_size, total_cost) != 0)
         return 1;
-    }
 
-    fprintf(fout, "%d %d\n", total_cost, tour_size);
-    for (int i = 0; i < tour_size; i++)
-        fprintf(fout, "%d\n", cities[tour[i]].id);
-    fprintf(fout, "\n");
-    fclose(fout);
+    free(cities);
+    free(tour);
+    solver_context_free(&ctx);
 
     // ==== ends here ===> execution time calculation
     clock_t end = clock();
@@ -184,4 +271,4 @@ int main(int argc, char *argv[])
     printf("Execution time: %.8f seconds\n", elapsed_secs);
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,86 @@
+// metric.h
+// distance functions of the instance types we read (our own format is EUC_2D), as in TSPLIB 95
+// all of them are static inline so the kernels in tsp_kernels.h get them inlined, one copy per metric
+#include <math.h>
+#include "city.h"
+
+#ifndef METRIC_H
+#define METRIC_H
+
+enum
+{
+    METRIC_EUC_2D, // Euclidean rounded to the nearest integer, the default
+    METRIC_CEIL_2D, // Euclidean rounded up
+    METRIC_ATT,    // pseudo-Euclidean of the att48 / att532 instances
+    METRIC_GEO     // great circle distance on the idealized earth, coordinates are DDD.MM lat / long
+};
+
+// GEO coordinates are stored as int(DDD.MM * GEO_SCALE) in City.x (latitude) and City.y (longitude)
+#define GEO_SCALE 1000
+
+static inline int dist_euc_2d(const City *a, const City *b)
+{
+    double dx = a->x - b->x;
+    double dy = a->y - b->y;
+    return (int)(round(sqrt(dx * dx + dy * dy)));
+}
+
+static inline int dist_ceil_2d(const City *a, const City *b)
+{
+    double dx = a->x - b->x;
+    double dy = a->y - b->y;
+    return (int)ceil(sqrt(dx * dx + dy * dy));
+}
+
+static inline int dist_att(const City *a, const City *b)
+{
+    double dx = a->x - b->x;
+    double dy = a->y - b->y;
+    double r = sqrt((dx * dx + dy * dy) / 10.0);
+    int t = (int)(r + 0.5);
+    return t < r ? t + 1 : t;
+}
+
+// degrees.minutes to radians, the degree part truncated like the reference implementations do
+static inline double geo_radians(int v)
+{
+    double c = (double)v / GEO_SCALE;
+    int deg = (int)c;
+    double min = c - deg;
+    return 3.141592 * (deg + 5.0 * min / 3.0) / 180.0;
+}
+
+// the +1 of the formula would make a point 1 away from itself, same coordinates are 0 here
+static inline int dist_geo(const City *a, const City *b)
+{
+    const double rrr = 6378.388;
+    if (a->x == b->x && a->y == b->y)
+        return 0;
+    double lat_a = geo_radians(a->x), lon_a = geo_radians(a->y);
+    double lat_b = geo_radians(b->x), lon_b = geo_radians(b->y);
+    double q1 = cos(lon_a - lon_b);
+    double q2 = cos(lat_a - lat_b);
+    double q3 = cos(lat_a + lat_b);
+    double c = 0.5 * ((1.0 + q1) * q2 - (1.0 - q1) * q3);
+    if (c > 1.0) // rounding can push it just past the domain of acos
+        c = 1.0;
+    return (int)(rrr * acos(c) + 1.0);
+}
+
+// distance under a metric picked at run time, for code outside the hot loops
+static inline int metric_distance(int metric, const City *a, const City *b)
+{
+    switch (metric)
+    {
+    case METRIC_CEIL_2D:
+        return dist_ceil_2d(a, b);
+    case METRIC_ATT:
+        return dist_att(a, b);
+    case METRIC_GEO:
+        return dist_geo(a, b);
+    default:
+        return dist_euc_2d(a, b);
+    }
+}
+
+#endif
@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tsp.h"
+
+// multilevel optimization (after Walshaw): on 500k+ city inputs the Morton tour is poor at the global
+// scale and 2-opt would have to fix it one edge at a time. instead the instance is coarsened: every
+// node is matched with its nearest unmatched neighbour, the pair becomes one node at their midpoint
+// (a fixed edge the coarse tour goes through), and this repeats until a few hundred nodes are left.
+// the coarsest level is solved with full 2-opt, then every level is expanded back into its children
+// and refined with neighbor-list 2-opt, down to the real cities where pruning takes the penalties in.
+// refinement uses kNN lists unless Delaunay candidates are asked for (the window moves of the default
+// pipeline have no meaning here, so window and knn are the same); matching always uses kNN. the coarsest
+// level always starts in Morton order, --construct insertion/greedy is refused with --multilevel.
+
+#define MULTILEVEL_COARSEST 500 // stop coarsening below this many nodes
+#define MULTILEVEL_MIN_SHRINK 0.95 // stop if a round of matching no longer shrinks the level
+#define MULTILEVEL_NEIGHBORS 8
+
+typedef struct
+{
+    City *pts;   // node positions; level 0 are the cities themselves
+    int *child;  // coarse node i expands into child[2i], child[2i+1] (-1 if it had no partner)
+    int n;
+} Level;
+
+// one round of matching: fills the next level from the current one, returns its node count
+static int coarsen(SolverContext *ctx, const Level *fine, Level *coarse)
+{
+    int n = fine->n;
+    int *pair = arena_alloc(&ctx->arena, (size_t)2 * n * sizeof(int)); // becomes coarse->child
+    ArenaMark mark = arena_mark(&ctx->arena);
+    char *matched = arena_alloc(&ctx->arena, (size_t)n);
+    memset(matched, 0, (size_t)n);
+    CandidateGraph cg;
+    build_knn_candidates(&ctx->arena, ctx->metric, fine->pts, n, MULTILEVEL_NEIGHBORS, &cg);
+
+    // fine nodes are in Morton order, so coarse nodes come out (roughly) in Morton order as well
+    int m = 0;
+    for (int u = 0; u < n; u++)
+    {
+        if (matched[u])
+            continue;
+        matched[u] = 1;
+        int v = -1;
+        for (int e = cg.start[u]; e < cg.start[u + 1]; e++)
+            if (!matched[cg.adj[e]])
+            {
+                v = cg.adj[e]; // nearest unmatched
+                break;
+            }
+        if (v >= 0)
+            matched[v] = 1;
+        pair[2 * m] = u;
+        pair[2 * m + 1] = v;
+        m++;
+    }
+    arena_release(&ctx->arena, mark);
+
+    coarse->n = m;
+    coarse->pts = arena_alloc(&ctx->arena, (size_t)m * sizeof(City));
+    coarse->child = pair;
+    for (int i = 0; i < m; i++)
+    {
+        const City *a = &fine->pts[pair[2 * i]];
+        const City *b = pair[2 * i + 1] >= 0 ? &fine->pts[pair[2 * i + 1]] : a;
+        coarse->pts[i].id = i;
+        coarse->pts[i].x = (int)(((long long)a->x + b->x) / 2);
+        coarse->pts[i].y = (int)(((long long)a->y + b->y) / 2);
+        coarse->pts[i].penalty = 0; // coarse tours go through every node
+        coarse->pts[i].morton = 0;
+    }
+    return m;
+}
+
+// replace every coarse node of tour by its children; a pair is laid out in the order that fits best
+// between the city placed before it and the next coarse node
+static int expand(int metric, const Level *coarse, const Level *fine, const int *tour, int tour_n, int *out)
+{
+    int m = 0;
+    for (int i = 0; i < tour_n; i++)
+    {
+        int u = coarse->child[2 * tour[i]], v = coarse->child[2 * tour[i] + 1];
+        if (v < 0)
+        {
+            out[m++] = u;
+            continue;
+        }
+        const City *next = &coarse->pts[tour[i + 1 == tour_n ? 0 : i + 1]];
+        if (m > 0)
+        {
+            const City *prev = &fine->pts[out[m - 1]];
+            int uv = metric_distance(metric, prev, &fine->pts[u]) + metric_distance(metric, &fine->pts[v], next);
+            int vu = metric_distance(metric, prev, &fine->pts[v]) + metric_distance(metric, &fine->pts[u], next);
+            if (vu < uv)
+            {
+                int t = u;
+                u = v;
+                v = t;
+            }
+        }
+        out[m++] = u;
+        out[m++] = v;
+    }
+    return m;
+}
+
+void solve_multilevel(SolverContext *ctx, const SolveOptions *opt, City *cities, int n, int *tour, int *tour_size)
+{
+    // at most one level per halving, plus slack for rounds that shrink less
+    Level levels[64];
+    int depth = 0;
+    levels[0].pts = cities;
+    levels[0].child = NULL;
+    levels[0].n = n;
+
+    ArenaMark mark = arena_mark(&ctx->arena);
+    int kind = opt->candidates == CANDIDATES_DELAUNAY ? CANDIDATES_DELAUNAY : CANDIDATES_KNN;
+    while (depth + 1 < 64 && levels[depth].n > MULTILEVEL_COARSEST)
+    {
+        int m = coarsen(ctx, &levels[depth], &levels[depth + 1]);
+        depth++;
+        if (ctx->verbose)
+            printf("Multilevel: level %d has %d nodes\n", depth, m);
+        if (m > MULTILEVEL_MIN_SHRINK * levels[depth - 1].n)
+            break;
+    }
+
+    // coarsest level: nodes are in Morton order already, full 2-opt is cheap at this size
+    // tour buffers: the caller's tour array plus one more of the same size from the arena
+    int *cur = tour, *other = arena_alloc(&ctx->arena, (size_t)n * sizeof(int));
+    Level *top = &levels[depth];
+    for (int i = 0; i < top->n; i++)
+        cur[i] = i;
+    solver_set_tour(ctx, top->pts, cur, top->n, top->n);
+    two_opt(ctx, top->pts, cur, top->n);
+    if (ctx->verbose)
+        printf("Multilevel: coarsest tour over %d nodes, length %llu\n", top->n, ctx->tour_len);
+
+    // uncoarsen one level at a time and refine each with neighbor-list 2-opt
+    int cur_n = top->n;
+    for (int l = depth; l > 0; l--)
+    {
+        Level *fine = &levels[l - 1];
+        cur_n = expand(ctx->metric, &levels[l], fine, cur, cur_n, other);
+        int *t = cur;
+        cur = other;
+        other = t;
+
+        ArenaMark level_mark = arena_mark(&ctx->arena);
+        CandidateGraph cg;
+        build_candidates(&ctx->arena, kind, ctx->metric, fine->pts, fine->n, MULTILEVEL_NEIGHBORS, &cg);
+        solver_set_tour(ctx, fine->pts, cur, cur_n, fine->n);
+        two_opt_neighbors(ctx, fine->pts, cur, cur_n, &cg, NULL, 0);
+        if (ctx->verbose)
+            printf("Multilevel: level %d refined, %d nodes, length %llu\n", l - 1, cur_n, ctx->tour_len);
+
+        if (l == 1)
+        {
+            // finest level: the real cities, now penalties decide which of them stay
+            *tour_size = cur_n;
+            for (int i = 0; i < opt->prune_rounds; i++)
+                if (prune_tour(ctx, cities, cur, tour_size) == 0)
+                    break;
+            two_opt_neighbors(ctx, cities, cur, *tour_size, &cg, NULL, 0);
+        }
+        arena_release(&ctx->arena, level_mark);
+    }
+
+    if (depth == 0) // small input, no coarsening happened: the coarsest tour is over the cities already
+    {
+        *tour_size = cur_n;
+        for (int i = 0; i < opt->prune_rounds; i++)
+            if (prune_tour(ctx, cities, cur, tour_size) == 0)
+                break;
+        CandidateGraph cg;
+        build_candidates(&ctx->arena, kind, ctx->metric, cities, n, MULTILEVEL_NEIGHBORS, &cg);
+        two_opt_neighbors(ctx, cities, cur, *tour_size, &cg, NULL, 0);
+    }
+    if (cur != tour)
+        memcpy(tour, cur, (size_t)*tour_size * sizeof(int));
+    arena_release(&ctx->arena, mark);
+}
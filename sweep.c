@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "tsp.h"
+
+// penalty sweep: the same cities solved at many penalty values, to pick an operating point. only the
+// skip decisions depend on the penalty, so the tour through every city is optimized once (greedy edges
+// and neighbor-list 2-opt), then every penalty starts from a copy of it: the cities that do not pay for
+// themselves are pruned, and 2-opt only runs around what was dropped. steps do not build on each other,
+// carrying the pruned tour of a low penalty into the next step left the higher ones far from a fresh solve.
+// every city gets the penalty of the step (per-city penalties of the input are replaced, with a warning)
+// prints the cost curve (and writes it to <output>.curve), every tour goes to <output>.<penalty>
+
+#define SWEEP_MAX_PENALTIES 100000 // every step writes a tour file, more than this is a typo in the spec
+
+static int compare_ints(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// "100,200,500" or "lo:hi:step"; returns a malloc'ed list in *out and its length, -1 on a bad spec
+// the list comes back in increasing order without duplicates (each penalty has one output file)
+int parse_penalty_list(const char *spec, int **out)
+{
+    int lo, hi, step, count = 0;
+    char tail;
+    *out = NULL;
+    if (sscanf(spec, "%d:%d:%d%c", &lo, &hi, &step, &tail) == 3)
+    {
+        if (lo < 0 || step <= 0 || hi < lo) // penalties are never negative, as in the list form
+            return -1;
+        long long range = ((long long)hi - lo) / step + 1;
+        if (range > SWEEP_MAX_PENALTIES)
+            return -1;
+        count = (int)range;
+        *out = malloc((size_t)count * sizeof(int));
+        if (!*out)
+            return -1;
+        for (int i = 0; i < count; i++)
+            (*out)[i] = (int)(lo + (long long)i * step); // at most hi
+        return count;
+    }
+
+    for (const char *p = spec; *p; p++)
+        if (*p == ',')
+            count++;
+    if (count >= SWEEP_MAX_PENALTIES)
+        return -1;
+    *out = malloc((size_t)(count + 1) * sizeof(int));
+    if (!*out)
+        return -1;
+    count = 0;
+    for (const char *p = spec; *p;)
+    {
+        char *end;
+        long v = strtol(p, &end, 10);
+        if (end == p || v < 0 || v > INT_MAX || (*end != ',' && *end != '\0'))
+        {
+            free(*out);
+            *out = NULL;
+            return -1;
+        }
+        (*out)[count++] = (int)v;
+        p = *end ? end + 1 : end;
+    }
+    qsort(*out, (size_t)count, sizeof(int), compare_ints);
+    int unique = 0;
+    for (int i = 0; i < count; i++)
+        if (unique == 0 || (*out)[i] != (*out)[unique - 1])
+            (*out)[unique++] = (*out)[i];
+    return unique;
+}
+
+// prune_tour, then the kept cities next to every dropped run are added to seeds
+static void prune_seeded(SolverContext *ctx, City *cities, int *tour, int *tour_size, int *seeds, int *seed_count)
+{
+    int n = *tour_size;
+    ArenaMark mark = arena_mark(&ctx->arena);
+    int *before = arena_alloc(&ctx->arena, (size_t)n * sizeof(int) + sizeof(int));
+    memcpy(before, tour, (size_t)n * sizeof(int));
+    prune_tour(ctx, cities, tour, tour_size);
+
+    if (*tour_size < n && *tour_size > 0)
+    {
+        // tour is a subsequence of before: walk both, a run of dropped cities ends at the next kept one
+        int k = 0, gap = 0, last = tour[*tour_size - 1];
+        for (int i = 0; i < n; i++)
+        {
+            if (k < *tour_size && before[i] == tour[k])
+            {
+                if (gap)
+                {
+                    seeds[(*seed_count)++] = last;
+                    seeds[(*seed_count)++] = tour[k];
+                }
+                last = tour[k++];
+                gap = 0;
+            }
+            else
+                gap = 1;
+        }
+        if (gap) // run wrapping past the end
+        {
+            seeds[(*seed_count)++] = last;
+            seeds[(*seed_count)++] = tour[0];
+        }
+    }
+    arena_release(&ctx->arena, mark);
+}
+
+int run_sweep(SolverContext *ctx, const SolveOptions *opt, City *cities, int n, int *penalties, int count, const char *output)
+{
+    double t0 = solver_now();
+    solver_begin(ctx, opt, cities, n);
+    for (int c = 1; c < n; c++)
+        if (cities[c].penalty != cities[0].penalty)
+        {
+            fprintf(stderr, "Warning: the input has per-city penalties, the sweep gives every city the penalty of the step\n");
+            break;
+        }
+    ArenaMark mark = arena_mark(&ctx->arena);
+
+    CandidateGraph cg;
+    int kind = opt->candidates == CANDIDATES_KNN ? CANDIDATES_KNN : CANDIDATES_DELAUNAY;
+    build_candidates(&ctx->arena, kind, ctx->metric, cities, n, CANDIDATE_NEIGHBORS, &cg);
+
+    // the shared tour through every city, optimized once. always greedy whatever --construct says:
+    // insertion would decide the skips for one penalty, and a Morton start ends up a few percent longer
+    // after neighbor-list 2-opt, which every step of the sweep would inherit
+    int *shared = arena_alloc(&ctx->arena, (size_t)n * sizeof(int) + sizeof(int));
+    int shared_size = construct_greedy(ctx, cities, n, &cg, shared);
+    two_opt_neighbors(ctx, cities, shared, shared_size, &cg, NULL, 0);
+    int *tour = arena_alloc(&ctx->arena, (size_t)n * sizeof(int) + sizeof(int));
+    int tour_size;
+    if (ctx->verbose)
+        printf("Sweep: shared tour over %d cities, length %llu, %.4f seconds\n", n, ctx->tour_len, solver_now() - t0);
+
+    FILE *curve = NULL;
+    char path[4096];
+    snprintf(path, sizeof(path), "%s.curve", output);
+    curve = fopen(path, "w");
+    if (!curve)
+        perror("Could not open curve file");
+    else
+        fprintf(curve, "penalty visited skipped tour_length total_cost\n");
+    printf("%10s %9s %9s %14s %14s %10s\n", "penalty", "visited", "skipped", "tour length", "total cost", "seconds");
+
+    // seeds: 2 per dropped run over all pruning rounds of a step, every run drops a city: at most 2n
+    int *seeds = arena_alloc(&ctx->arena, (size_t)(2 * n + 4) * sizeof(int));
+    int failed = 0, verbose = ctx->verbose;
+    ctx->verbose = 0; // the table is the progress output from here on
+    for (int k = 0; k < count; k++)
+    {
+        double tk = solver_now();
+        int p = penalties[k], seed_count = 0;
+        for (int c = 0; c < n; c++)
+            cities[c].penalty = p;
+        // every step starts over from the shared tour, so no step inherits the skips of the one before:
+        // the cities that do not pay for themselves at this penalty are dropped, 2-opt mends around them
+        memcpy(tour, shared, (size_t)shared_size * sizeof(int));
+        tour_size = shared_size;
+        solver_set_tour(ctx, cities, tour, tour_size, n);
+        for (int r = 0; r < opt->prune_rounds; r++)
+        {
+            int before = tour_size;
+            prune_seeded(ctx, cities, tour, &tour_size, seeds, &seed_count);
+            if (tour_size == before)
+                break;
+        }
+        if (seed_count > 0)
+            two_opt_neighbors(ctx, cities, tour, tour_size, &cg, seeds, seed_count);
+
+        unsigned long long total = solver_total_cost(ctx);
+        printf("%10d %9d %9d %14llu %14llu %10.4f\n", p, tour_size, ctx->skipped, ctx->tour_len, total, solver_now() - tk);
+        if (curve)
+            fprintf(curve, "%d %d %d %llu %llu\n", p, tour_size, ctx->skipped, ctx->tour_len, total);
+        snprintf(path, sizeof(path), "%s.%d", output, p);
+        if (write_output(path, cities, tour, tour_size, total) != 0)
+            failed++;
+    }
+    ctx->verbose = verbose;
+    if (curve)
+        fclose(curve);
+    if (ctx->verbose)
+        printf("Sweep done: %d penalties, %.4f seconds\n", count, solver_now() - t0);
+    arena_release(&ctx->arena, mark);
+    return failed ? -1 : 0;
+}
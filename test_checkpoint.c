@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tsp.h"
+
+// compile option -- gcc test_checkpoint.c tsp.c grid.c insertion.c decompose.c multilevel.c delaunay.c greedy.c tsplib.c warmstart.c sweep.c checkpoint.c -o test_checkpoint -lm -lpthread
+// checkpoint round trips on a generated instance (random-region 2-opt, so the rng state matters):
+//   - the checkpoint of a finished run loads back as its tour, and resuming it changes nothing
+//   - a snapshot taken where the optimize phase starts resumes to exactly the uninterrupted result
+//   - checkpoints of another instance, or cut short, are refused
+
+#define CITIES 3000
+#define DONE_PATH "test_checkpoint_done.ckpt"
+#define MID_PATH "test_checkpoint_mid.ckpt"
+#define BAD_PATH "test_checkpoint_bad.ckpt"
+
+static void generate(City *cities, int n)
+{
+    unsigned long long x = 88172645463325252ULL;
+    for (int c = 0; c < n; c++)
+    {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        cities[c].id = 1000 + 3 * c; // sparse ids, not indexes
+        cities[c].x = (int)((x >> 33) % 100000);
+        cities[c].y = (int)((x >> 13) % 100000);
+        cities[c].penalty = 1000;
+        cities[c].morton = 0;
+    }
+}
+
+// the tour as city ids, what has to survive a round trip
+static int same_tour(const City *a, const int *tour_a, const City *b, const int *tour_b, int size)
+{
+    for (int i = 0; i < size; i++)
+        if (a[tour_a[i]].id != b[tour_b[i]].id)
+            return 0;
+    return 1;
+}
+
+int main(void)
+{
+    int n = CITIES;
+    City *run = malloc(n * sizeof(City)), *again = malloc(n * sizeof(City));
+    int *tour = malloc(n * sizeof(int)), *resumed = malloc(n * sizeof(int));
+    SolverContext ctx;
+    if (!run || !again || !tour || !resumed || solver_context_init(&ctx, n) != 0)
+        return 1;
+
+    SolveOptions opt;
+    default_solve_options(&opt);
+    opt.seed = 12345;
+    opt.full_limit = 500; // random-region 2-opt at this size
+    opt.local_limit = 1000;
+
+    // uninterrupted run, checkpointed at every phase boundary (the interval never comes round)
+    generate(run, n);
+    int tour_size;
+    ctx.checkpoint = checkpoint_start(DONE_PATH, 1e9, run, n);
+    if (!ctx.checkpoint)
+        return 1;
+    solve_instance(&ctx, &opt, run, n, tour, &tour_size);
+    unsigned long long cost = solver_total_cost(&ctx);
+    if (checkpoint_finish(ctx.checkpoint, &ctx, tour, tour_size) != 0)
+        return 1;
+    printf("Full run   : %d of %d cities, total cost %llu\n", tour_size, n, cost);
+
+    // finished run: the file holds its tour, a resume from it is the same result
+    SolverProgress from;
+    int count;
+    generate(again, n);
+    int *ids = checkpoint_load(DONE_PATH, &opt, again, n, &from, &count);
+    int ok = ids && from.phase == PHASE_DONE && count == tour_size;
+    for (int i = 0; ok && i < count; i++)
+        ok = ids[i] == run[tour[i]].id;
+    int resumed_size = 0;
+    if (ok)
+    {
+        solve_resume(&ctx, &opt, again, n, &from, ids, count, resumed, &resumed_size);
+        ok = resumed_size == tour_size && solver_total_cost(&ctx) == cost && same_tour(run, tour, again, resumed, tour_size);
+    }
+    free(ids);
+    if (!ok)
+    {
+        fprintf(stderr, "Round trip of a finished run failed.\n");
+        return 1;
+    }
+    printf("Finished   : loads back as the same tour and cost\n");
+
+    // interrupted where the optimize phase starts: Morton tour over every city, rng as seeded
+    generate(again, n);
+    solver_begin(&ctx, &opt, again, n);
+    for (int i = 0; i < n; i++)
+        resumed[i] = i;
+    solver_set_tour(&ctx, again, resumed, n, n);
+    ctx.progress.phase = PHASE_OPTIMIZE;
+    ctx.progress.pass = 0;
+    ctx.progress.rng = ctx.rng;
+    ctx.progress.size_class = n;
+    Checkpointer *cp = checkpoint_start(MID_PATH, 1e9, again, n);
+    if (!cp || checkpoint_finish(cp, &ctx, resumed, n) != 0)
+        return 1;
+
+    generate(again, n);
+    ids = checkpoint_load(MID_PATH, &opt, again, n, &from, &count);
+    ok = ids && from.phase == PHASE_OPTIMIZE && from.pass == 0 && from.rng == opt.seed && from.size_class == n && count == n;
+    if (ok)
+    {
+        solve_resume(&ctx, &opt, again, n, &from, ids, count, resumed, &resumed_size);
+        ok = resumed_size == tour_size && solver_total_cost(&ctx) == cost && same_tour(run, tour, again, resumed, tour_size);
+    }
+    free(ids);
+    if (!ok)
+    {
+        fprintf(stderr, "Resume from the optimize phase did not reproduce the full run.\n");
+        return 1;
+    }
+    printf("Interrupted: resume reproduces the full run\n");
+
+    // another instance (one penalty changed) and a cut short file are refused
+    generate(again, n);
+    again[n / 2].penalty++;
+    ids = checkpoint_load(MID_PATH, &opt, again, n, &from, &count);
+    ok = ids == NULL;
+    free(ids);
+    size_t len;
+    char *buf = read_file(MID_PATH, &len);
+    FILE *f = fopen(BAD_PATH, "wb");
+    if (!buf || !f)
+        return 1;
+    fwrite(buf, 1, len - sizeof(int), f);
+    fclose(f);
+    free(buf);
+    generate(again, n);
+    ids = checkpoint_load(BAD_PATH, &opt, again, n, &from, &count);
+    ok = ok && ids == NULL;
+    free(ids);
+    if (!ok)
+    {
+        fprintf(stderr, "A checkpoint of another instance or a damaged one was accepted.\n");
+        return 1;
+    }
+    printf("Refused    : other instance, damaged file\n");
+
+    remove(DONE_PATH);
+    remove(MID_PATH);
+    remove(BAD_PATH);
+    solver_context_free(&ctx);
+    free(run);
+    free(again);
+    free(tour);
+    free(resumed);
+    printf("OK\n");
+    return 0;
+}
@@ -1,18 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "city.h"
+#include "tsp.h"
 #include <math.h>
 #include <stdint.h>
 
-#define MAX_LINE 100
 #define MAX_CITIES 5000
 
-int read_input(const char *filename, int *penalty, City *cities);
-int compare_morton(const void *a, const void *b);
-uint64_t morton_code(int x, int y);
-int distance(const City *a, const City *b);
-
 int main(void)
 {
 
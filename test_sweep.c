@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tsp.h"
+
+// compile option -- gcc test_sweep.c tsp.c grid.c insertion.c decompose.c multilevel.c delaunay.c greedy.c tsplib.c warmstart.c sweep.c checkpoint.c -o test_sweep -lm -lpthread
+// parse_penalty_list on good and bad --sweep specs: lists come back sorted without repeats, ranges
+// stay inside int, and specs that would overflow or allocate absurd sizes are refused
+
+typedef struct
+{
+    const char *spec;
+    int count;          // expected return value
+    int first, last;    // expected first and last penalty when count > 0
+} SweepCase;
+
+int main(void)
+{
+    static const SweepCase cases[] = {
+        {"100,200,500", 3, 100, 500},
+        {"300,100,300,200", 3, 100, 300}, // sorted, the repeated 300 dropped
+        {"7", 1, 7, 7},
+        {"20:100:20", 5, 20, 100},
+        {"20:110:20", 5, 20, 100}, // hi is not a multiple of step away from lo
+        {"5:5:1", 1, 5, 5},
+        {"2147483000:2147483647:100", 7, 2147483000, 2147483600}, // lo + i * step near INT_MAX
+        {"0:2147483647:100000", 21475, 0, 2147400000},
+        {"0:2147483647:1", -1, 0, 0}, // 2^31 penalties
+        {"-1:5:1", -1, 0, 0},
+        {"5:1:1", -1, 0, 0},
+        {"1:5:0", -1, 0, 0},
+        {"5,,6", -1, 0, 0},
+        {"5,-6", -1, 0, 0},
+        {"2147483648", -1, 0, 0},
+        {"abc", -1, 0, 0},
+    };
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        const SweepCase *t = &cases[i];
+        int *list = NULL;
+        int count = parse_penalty_list(t->spec, &list);
+        int ok = count == t->count;
+        if (ok && count > 0)
+        {
+            ok = list[0] == t->first && list[count - 1] == t->last;
+            for (int k = 1; k < count; k++)
+                if (list[k] <= list[k - 1])
+                    ok = 0;
+        }
+        if (!ok)
+        {
+            fprintf(stderr, "parse_penalty_list(\"%s\"): got %d, expected %d\n", t->spec, count, t->count);
+            failed++;
+        }
+        free(list);
+    }
+    if (failed)
+        return 1;
+    printf("Sweep specs: %d cases as expected\n", (int)(sizeof(cases) / sizeof(cases[0])));
+    printf("OK\n");
+    return 0;
+}
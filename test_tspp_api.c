@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tspp.h"
+#include "tsp.h"
+
+// compile option -- gcc test_tspp_api.c tsp.c tspp.c grid.c insertion.c decompose.c multilevel.c delaunay.c greedy.c tsplib.c warmstart.c sweep.c checkpoint.c -o test_tspp_api -lm -lpthread
+// solves test_input.txt through the library twice, once from text and once from arrays, on one handle,
+// then with per-city penalties both ways,
+// then a one-city instance with every construction and candidate graph, and the options size check
+
+int main(void)
+{
+    size_t len;
+    char *text = read_file("test_input.txt", &len);
+    if (!text)
+        return 1;
+
+    TsppSolver *s = tspp_create(NULL);
+    int n = tspp_load_text(s, text, len);
+    if (n <= 0 || tspp_solve(s, 1.0) != 0)
+    {
+        fprintf(stderr, "Solving from text failed.\n");
+        return 1;
+    }
+
+    TsppResult r1;
+    tspp_get_result(s, &r1);
+    printf("From text  : %d cities, total cost %llu, visited %d, skipped %d\n", n, r1.total_cost, r1.visited, r1.skipped);
+    printf("Tour order (city IDs):\n");
+    for (int i = 0; i < r1.visited; i++)
+        printf("%d ", r1.tour[i]);
+    printf("\n");
+    unsigned long long first_cost = r1.total_cost;
+
+    // same instance again from arrays, reusing the handle
+    int penalty;
+    City cities[64];
+    int m = parse_input(text, len, &penalty, cities, 64);
+    int ids[64], xs[64], ys[64];
+    for (int i = 0; i < m; i++)
+    {
+        ids[i] = cities[i].id;
+        xs[i] = cities[i].x;
+        ys[i] = cities[i].y;
+    }
+    tspp_load_cities(s, penalty, ids, xs, ys, m);
+    tspp_solve(s, 1.0);
+
+    TsppResult r2;
+    tspp_get_result(s, &r2);
+    printf("From arrays: %d cities, total cost %llu, visited %d, skipped %d\n", m, r2.total_cost, r2.visited, r2.skipped);
+
+    // per-city penalties: the text format's fourth column and the penalties array must agree
+    int pens[64];
+    char mixed[64 * 48];
+    int used = snprintf(mixed, sizeof(mixed), "%d\n", penalty);
+    for (int i = 0; i < m; i++)
+    {
+        pens[i] = i % 2 ? penalty * 4 : penalty / 4;
+        used += snprintf(mixed + used, sizeof(mixed) - (size_t)used, "%d %d %d %d\n", ids[i], xs[i], ys[i], pens[i]);
+    }
+    TsppResult r3, r4;
+    if (tspp_load_text(s, mixed, (size_t)used) != m || tspp_solve(s, 1.0) != 0 || tspp_get_result(s, &r3) != 0 ||
+        tspp_load_cities_penalties(s, penalty, pens, ids, xs, ys, m) != m || tspp_solve(s, 1.0) != 0 || tspp_get_result(s, &r4) != 0)
+    {
+        fprintf(stderr, "Solving with per-city penalties failed.\n");
+        return 1;
+    }
+    printf("Per city   : %d cities, total cost %llu from text, %llu from arrays\n", m, r3.total_cost, r4.total_cost);
+    if (r3.total_cost != r4.total_cost || r4.total_cost == first_cost)
+    {
+        fprintf(stderr, "Per-city penalties from arrays do not match the text load!\n");
+        return 1;
+    }
+
+    tspp_destroy(s);
+    free(text);
+
+    if (r2.total_cost != first_cost)
+    {
+        fprintf(stderr, "Costs differ between the two loads!\n");
+        return 1;
+    }
+
+    // one city: no neighbours for the candidate graphs, a tour of just that city at cost 0
+    for (int construct = TSPP_CONSTRUCT_MORTON; construct <= TSPP_CONSTRUCT_GREEDY; construct++)
+        for (int candidates = TSPP_CANDIDATES_WINDOW; candidates <= TSPP_CANDIDATES_DELAUNAY; candidates++)
+        {
+            TsppOptions opt;
+            tspp_default_options(&opt);
+            opt.construct = construct;
+            opt.candidates = candidates;
+            TsppSolver *one = tspp_create(&opt);
+            int id = 7, x = 10, y = 20;
+            TsppResult r;
+            if (!one || tspp_load_cities(one, 100, &id, &x, &y, 1) != 1 || tspp_solve(one, 1.0) != 0 ||
+                tspp_get_result(one, &r) != 0 || r.total_cost != 0 || r.visited != 1 || r.tour[0] != 7)
+            {
+                fprintf(stderr, "One-city instance failed (construct %d, candidates %d)\n", construct, candidates);
+                return 1;
+            }
+            tspp_destroy(one);
+        }
+    printf("One city   : OK with every construction and candidate graph\n");
+
+    // options from an older header (no fields past prune_rounds) are taken, the rest defaulted;
+    // options not filled by tspp_default_options are refused
+    TsppOptions old;
+    tspp_default_options(&old);
+    old.struct_size = offsetof(TsppOptions, verbose);
+    TsppSolver *older = tspp_create(&old);
+    old.struct_size = 0;
+    if (!older || tspp_create(&old) != NULL)
+    {
+        fprintf(stderr, "Options struct_size check failed.\n");
+        return 1;
+    }
+    tspp_destroy(older);
+    printf("Options    : OK for an older struct_size, refused without one\n");
+
+    // multilevel builds its own starting tour, another construction is refused rather than ignored
+    tspp_default_options(&old);
+    old.multilevel = 1;
+    old.construct = TSPP_CONSTRUCT_GREEDY;
+    if (tspp_create(&old) != NULL)
+    {
+        fprintf(stderr, "Multilevel with greedy construction was not refused.\n");
+        return 1;
+    }
+    printf("Multilevel : refused with another construction\n");
+    printf("OK\n");
+    return 0;
+}
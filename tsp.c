@@ -4,58 +4,135 @@
 #include <stdint.h>
 #include <math.h>
 #include <time.h>
+#include <limits.h>
+#include "tsp.h"
 
-#define MAX_LINE 100
-#define DEFAULT_MAX_CITIES 5000
+// solver core, built into the command line tool and into libtspp (build lines in README.md)
 
-// struct for cities
-typedef struct
+// parse the input format from memory: first line is the penalty, then one "id x y" city per line, or
+// "id x y penalty" for a city with its own skip cost (the first line is the default for the others)
+// lines that do not hold three integers are ignored; only the first max_cities cities are stored but
+// all of them are counted so the caller can tell the input was cut
+static const char *parse_int(const char *p, const char *end, int *out)
 {
-    int id;
-    int x, y; // euclid coordinates
-    uint64_t morton;
-} City;
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        p++;
+    int neg = 0;
+    if (p < end && (*p == '-' || *p == '+'))
+        neg = (*p++ == '-');
+    if (p == end || *p < '0' || *p > '9')
+        return NULL;
+    long long v = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+        v = v * 10 + (*p++ - '0');
+    *out = (int)(neg ? -v : v);
+    return p;
+}
 
-// read input
-int read_input(const char *filename, int *penalty, City *cities)
+int parse_input(const char *buf, size_t len, int *penalty, City *cities, int max_cities)
 {
-    FILE *f = fopen(filename, "r");
-    if (!f)
+    const char *p = buf, *end = buf + len;
+    const char *eol = memchr(p, '\n', len);
+    if (len == 0 || !parse_int(p, eol ? eol : end, penalty))
     {
-        perror("File open error");
+        fprintf(stderr, "Error: Could not read penalty line\n");
         return -1;
     }
+    p = eol ? eol + 1 : end;
 
-    char line[MAX_LINE]; // input buffer
     int city_count = 0;
+    while (p < end)
+    {
+        eol = memchr(p, '\n', (size_t)(end - p));
+        const char *line_end = eol ? eol : end;
+        int id, x, y, own;
+        const char *q = parse_int(p, line_end, &id);
+        if (q)
+            q = parse_int(q, line_end, &x);
+        if (q)
+            q = parse_int(q, line_end, &y);
+        if (q) // input format is strict
+        {
+            if (city_count < max_cities)
+            {
+                cities[city_count].id = id;
+                cities[city_count].x = x;
+                cities[city_count].y = y;
+                cities[city_count].penalty = parse_int(q, line_end, &own) ? own : *penalty;
+            }
+            city_count++;
+        }
+        p = eol ? eol + 1 : end;
+    }
+    return city_count;
+}
 
-    // Read penalty
-    if (fgets(line, sizeof(line), f) == NULL)
+// binary instance, see TspbHeader in tsp.h; same contract as parse_input
+int parse_binary(const char *buf, size_t len, int *penalty, City *cities, int max_cities)
+{
+    TspbHeader h;
+    if (len < sizeof(h))
     {
-        fprintf(stderr, "Error: Could not read penalty line\n");
-        fclose(f);
+        fprintf(stderr, "Error: Binary instance too short\n");
         return -1;
     }
-
-    *penalty = atoi(line); // first line always pentaly
-    int id, x, y;
-
-    while (fgets(line, sizeof(line), f))
+    memcpy(&h, buf, sizeof(h));
+    size_t fields = (h.flags & TSPB_PER_CITY_PENALTY) ? 4 : 3;
+    if (memcmp(h.magic, TSPB_MAGIC, 4) != 0 || h.version != TSPB_VERSION || h.count < 0 || h.count > INT_MAX ||
+        (len - sizeof(h)) / (fields * sizeof(int32_t)) < (size_t)h.count)
     {
-        // check for blank line (end of input)
-        if (strlen(line) < 1)
-            break;
+        fprintf(stderr, "Error: Not a binary instance of version %d, or truncated\n", TSPB_VERSION);
+        return -1;
+    }
+    *penalty = h.penalty;
+    const char *p = buf + sizeof(h);
+    int city_count = (int)h.count;
+    for (int i = 0; i < city_count && i < max_cities; i++)
+    {
+        int32_t r[4];
+        r[3] = h.penalty;
+        memcpy(r, p + (size_t)i * fields * sizeof(int32_t), fields * sizeof(int32_t));
+        cities[i].id = r[0];
+        cities[i].x = r[1];
+        cities[i].y = r[2];
+        cities[i].penalty = r[3];
+    }
+    return city_count;
+}
 
-        // input format is strict
-        if (sscanf(line, "%d %d %d", &id, &x, &y) == 3)
-        {
-            cities[city_count].id = id;
-            cities[city_count].x = x;
-            cities[city_count].y = y;
-            city_count++;
-        }
+// whole file in one buffer, caller frees
+char *read_file(const char *filename, size_t *len)
+{
+    FILE *f = fopen(filename, "rb");
+    if (!f)
+    {
+        perror("File open error");
+        return NULL;
     }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = malloc(size > 0 ? (size_t)size : 1);
+    if (!buf)
+    {
+        fprintf(stderr, "Memory allocation failed reading %s.\n", filename);
+        fclose(f);
+        return NULL;
+    }
+    *len = fread(buf, 1, (size_t)size, f);
     fclose(f);
+    return buf;
+}
+
+// read input, cities must have room for every city in the file
+int read_input(const char *filename, int *penalty, City *cities)
+{
+    size_t len;
+    char *buf = read_file(filename, &len);
+    if (!buf)
+        return -1;
+    int city_count = parse_input(buf, len, penalty, cities, INT_MAX);
+    free(buf);
     return city_count; // Return the number of cities read
 }
 
@@ -69,8 +146,6 @@ x_mapped = (int)(((x - min_x) * 65535.0) / (max_x - min_x));
 y_mapped = (int)(((y - min_y) * 65535.0) / (max_y - min_y));
 */
 
-#include <stdint.h>
-
 // Helper to "spread" bits (see note below)
 uint32_t part1by1(uint32_t n)
 {
@@ -99,11 +174,193 @@ int compare_morton(const void *a, const void *b)
     return 0;
 }
 
+// map all coordinates to [0,65535] and assign Morton codes
+void assign_morton_codes(City *cities, int n)
+{
+    if (n <= 0)
+        return;
+    // Step 1: Find min and max for x and y
+    int min_x = cities[0].x, max_x = cities[0].x;
+    int min_y = cities[0].y, max_y = cities[0].y;
+    for (int i = 1; i < n; i++)
+    {
+        if (cities[i].x < min_x)
+            min_x = cities[i].x;
+        if (cities[i].x > max_x)
+            max_x = cities[i].x;
+        if (cities[i].y < min_y)
+            min_y = cities[i].y;
+        if (cities[i].y > max_y)
+            max_y = cities[i].y;
+    }
+
+    // Step 2: Map all coordinates to [0,65535] and assign Morton codes
+    for (int i = 0; i < n; i++)
+    {
+        int x_mapped = (max_x == min_x) ? 0 : (int)(((double)(cities[i].x - min_x) * 65535.0) / (max_x - min_x));
+        int y_mapped = (max_y == min_y) ? 0 : (int)(((double)(cities[i].y - min_y) * 65535.0) / (max_y - min_y));
+        cities[i].morton = morton_code(x_mapped, y_mapped);
+    }
+}
+
+// rounded Euclidean (METRIC_EUC_2D), the metric of our own input format
 int distance(const City *a, const City *b)
 {
-    double dx = a->x - b->x;
-    double dy = a->y - b->y;
-    return (int)(round(sqrt(dx * dx + dy * dy)));
+    return dist_euc_2d(a, b);
+}
+
+// scratch memory, see SolverContext in tsp.h
+#define ARENA_ALIGN 16
+#define ARENA_MIN_BLOCK (1 << 20)
+
+static ArenaBlock *arena_new_block(size_t size)
+{
+    if (size < ARENA_MIN_BLOCK)
+        size = ARENA_MIN_BLOCK;
+    ArenaBlock *b = malloc(sizeof(ArenaBlock) + size);
+    if (!b)
+        return NULL;
+    b->next = NULL;
+    b->size = size;
+    b->used = 0;
+    return b;
+}
+
+// a block could not be allocated: the library (tspp.c) catches this with on_failure and fails the call,
+// the command line tools have nothing better to do than stop
+void arena_out_of_memory(Arena *arena, size_t size)
+{
+    if (arena->on_failure)
+        longjmp(*arena->on_failure, 1);
+    fprintf(stderr, "Memory allocation failed in arena (%zu bytes).\n", size);
+    exit(1);
+}
+
+// returns 0, or -1 if the first block could not be allocated
+int arena_init(Arena *arena, size_t size)
+{
+    arena->on_failure = NULL;
+    arena->head = arena_new_block(size);
+    arena->cur = arena->head;
+    if (!arena->head)
+    {
+        fprintf(stderr, "Memory allocation failed in arena (%zu bytes).\n", size);
+        return -1;
+    }
+    return 0;
+}
+
+void arena_free(Arena *arena)
+{
+    ArenaBlock *b = arena->head;
+    while (b)
+    {
+        ArenaBlock *next = b->next;
+        free(b);
+        b = next;
+    }
+    arena->head = arena->cur = NULL;
+}
+
+// bump allocation; if the current block is full move on to the next one (kept from earlier use)
+// or chain a new block, so pointers handed out before stay valid
+void *arena_alloc(Arena *arena, size_t bytes)
+{
+    bytes = (bytes + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    ArenaBlock *b = arena->cur;
+    while (b->used + bytes > b->size)
+    {
+        if (!b->next || b->next->size < bytes)
+        {
+            ArenaBlock *nb = arena_new_block(bytes > b->size ? bytes : b->size);
+            if (!nb)
+                arena_out_of_memory(arena, bytes > b->size ? bytes : b->size);
+            nb->next = b->next;
+            b->next = nb;
+        }
+        b = b->next;
+        b->used = 0;
+    }
+    arena->cur = b;
+    void *p = b->data + b->used;
+    b->used += bytes;
+    return p;
+}
+
+ArenaMark arena_mark(const Arena *arena)
+{
+    ArenaMark m = {arena->cur, arena->cur->used};
+    return m;
+}
+
+void arena_release(Arena *arena, ArenaMark mark)
+{
+    arena->cur = mark.block;
+    arena->cur->used = mark.used;
+}
+
+// rough per-city budget for the fixed buffers plus whatever phases carve out with arena_alloc
+#define ARENA_BYTES_PER_CITY 64
+
+// returns 0, or -1 if out of memory
+int solver_context_init(SolverContext *ctx, int n)
+{
+    if (arena_init(&ctx->arena, (size_t)n * ARENA_BYTES_PER_CITY) != 0)
+    {
+        ctx->capacity = 0;
+        return -1;
+    }
+    ctx->capacity = n;
+    ctx->tour_len = 0;
+    ctx->skipped = 0;
+    ctx->skip_cost = 0;
+    ctx->total_cities = 0;
+    ctx->metric = METRIC_EUC_2D;
+    ctx->verbose = 0;
+    ctx->deadline = 0;
+    ctx->rng = 0x9E3779B97F4A7C15ULL;
+    memset(&ctx->progress, 0, sizeof(ctx->progress));
+    ctx->checkpoint = NULL;
+    ctx->marks = arena_alloc(&ctx->arena, (size_t)n * sizeof(char));
+    ctx->scratch = arena_alloc(&ctx->arena, (size_t)n * sizeof(int));
+    return 0;
+}
+
+// make room for n cities, keeping the arena when it is already big enough (reuse across instances)
+// returns 0, or -1 if out of memory (the context is left empty then)
+int solver_context_reserve(SolverContext *ctx, int n)
+{
+    if (ctx->capacity >= n && ctx->arena.head)
+    {
+        arena_release(&ctx->arena, (ArenaMark){ctx->arena.head, 0});
+        ctx->marks = arena_alloc(&ctx->arena, (size_t)ctx->capacity * sizeof(char));
+        ctx->scratch = arena_alloc(&ctx->arena, (size_t)ctx->capacity * sizeof(int));
+        return 0;
+    }
+    int verbose = ctx->verbose, metric = ctx->metric;
+    double deadline = ctx->deadline;
+    uint64_t rng = ctx->rng;
+    Checkpointer *checkpoint = ctx->checkpoint;
+    jmp_buf *on_failure = ctx->arena.on_failure;
+    if (ctx->arena.head)
+        solver_context_free(ctx);
+    if (solver_context_init(ctx, n) != 0)
+        return -1;
+    ctx->metric = metric;
+    ctx->verbose = verbose;
+    ctx->deadline = deadline;
+    ctx->rng = rng;
+    ctx->checkpoint = checkpoint;
+    ctx->arena.on_failure = on_failure;
+    return 0;
+}
+
+void solver_context_free(SolverContext *ctx)
+{
+    arena_free(&ctx->arena);
+    ctx->capacity = 0;
+    ctx->marks = NULL;
+    ctx->scratch = NULL;
 }
 
 // after finding a base tour with the Morton heuristic approach improve it by 2-opt
@@ -136,345 +393,615 @@ int tour_length(const City *cities, const int *tour, int n)
 
 unsigned long long tour_length(const City *cities, const int *tour, int n)
 {
+    return tour_length_metric(METRIC_EUC_2D, cities, tour, n);
+}
+
+unsigned long long tour_length_metric(int metric, const City *cities, const int *tour, int n)
+{
+    if (n <= 1)
+        return 0;
     unsigned long long len = 0;
-    for (int i = 0; i < n; i++)
+    for (int i = 0; i < n - 1; i++)
+        len += metric_distance(metric, &cities[tour[i]], &cities[tour[i + 1]]);
+    return len + metric_distance(metric, &cities[tour[n - 1]], &cities[tour[0]]); // closing edge
+}
+
+// start the incremental bookkeeping for a tour of tour_size cities out of total_cities
+// this is the only full walk, moves below keep the values up to date by their deltas
+void solver_set_tour(SolverContext *ctx, const City *cities, const int *tour, int tour_size, int total_cities)
+{
+    ctx->tour_len = tour_length_metric(ctx->metric, cities, tour, tour_size);
+    ctx->skipped = total_cities - tour_size;
+    ctx->total_cities = total_cities;
+    unsigned long long all = 0, visited = 0;
+    for (int c = 0; c < total_cities; c++)
+        all += (unsigned long long)cities[c].penalty;
+    for (int i = 0; i < tour_size; i++)
+        visited += (unsigned long long)cities[tour[i]].penalty;
+    ctx->skip_cost = all - visited;
+}
+
+unsigned long long solver_total_cost(const SolverContext *ctx)
+{
+    return ctx->tour_len + ctx->skip_cost;
+}
+
+// wall clock seconds, used for solve budgets (clock() counts cpu time of every thread)
+double solver_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// per-solver random numbers (xorshift64*), rand() is shared by every thread and reseeded by srand
+uint64_t solver_rand(SolverContext *ctx)
+{
+    uint64_t x = ctx->rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    ctx->rng = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+int solver_out_of_time(const SolverContext *ctx)
+{
+    return ctx->deadline > 0 && solver_now() > ctx->deadline;
+}
+
+// compile with -DTSP_DEBUG_COST to cross-check the running values against a full recomputation after each phase
+#ifdef TSP_DEBUG_COST
+void solver_check_cost(const SolverContext *ctx, const City *cities, const int *tour, int tour_size, const char *where)
+{
+    unsigned long long full = tour_length_metric(ctx->metric, cities, tour, tour_size);
+    if (full != ctx->tour_len)
     {
-        const City *a = &cities[tour[i]];
-        const City *b = &cities[tour[(i + 1) % n]];
-        len += distance(a, b);
+        fprintf(stderr, "Cost bookkeeping mismatch after %s: running %llu, recomputed %llu\n", where, ctx->tour_len, full);
+        abort();
+    }
+    // the skipped set is every city not on the tour: recount it and its penalties, which makes the total exact too
+    unsigned long long all = 0, visited = 0;
+    for (int c = 0; c < ctx->total_cities; c++)
+        all += (unsigned long long)cities[c].penalty;
+    for (int i = 0; i < tour_size; i++)
+        visited += (unsigned long long)cities[tour[i]].penalty;
+    if (ctx->total_cities - tour_size != ctx->skipped || all - visited != ctx->skip_cost)
+    {
+        fprintf(stderr, "Skip bookkeeping mismatch after %s: running %d skipped for %llu, recomputed %d for %llu\n",
+                where, ctx->skipped, ctx->skip_cost, ctx->total_cities - tour_size, all - visited);
+        abort();
+    }
+}
+#endif
+
+// reverse the cyclic stretch of positions i..j (j may have wrapped past the end), keeping pos in sync
+// the shorter of the stretch and its complement is reversed, both give the same cycle
+static void reverse_cyclic(int *tour, int *pos, int n, int i, int j)
+{
+    int len = j - i;
+    if (len < 0)
+        len += n;
+    len += 1;
+    if (2 * len > n) // reverse the complement j+1 .. i-1 instead
+    {
+        int ni = j + 1 == n ? 0 : j + 1;
+        int nj = i == 0 ? n - 1 : i - 1;
+        i = ni;
+        j = nj;
+        len = n - len;
+    }
+    for (int k = 0; k < len / 2; k++)
+    {
+        int a = tour[i], b = tour[j];
+        tour[i] = b;
+        pos[b] = i;
+        tour[j] = a;
+        pos[a] = j;
+        i = i + 1 == n ? 0 : i + 1;
+        j = j == 0 ? n - 1 : j - 1;
     }
-    return len;
 }
 
+// max-heap of tour positions keyed by what dropping the city there saves, for prune_tour
+// slot[p] is where position p sits in item (-1 while it is not worth dropping), so the saving of a
+// neighbour can be changed in place after every drop
+typedef struct
+{
+    int *item;
+    int *slot;
+    long long *key;
+    int size;
+} DropHeap;
 
-// Basic, full 2-opt
-void two_opt(City *cities, int *tour, int n)
+static void drop_heap_place(DropHeap *h, int i, int p)
+{
+    h->item[i] = p;
+    h->slot[p] = i;
+}
+
+static void drop_heap_up(DropHeap *h, int i)
 {
-    int improved = 1;
-    while (improved)
+    int p = h->item[i];
+    while (i > 0 && h->key[h->item[(i - 1) / 2]] < h->key[p])
     {
-        improved = 0;
-        for (int i = 0; i < n - 1; i++)
-        {
-            for (int j = i + 2; j < n && (i != 0 || j != n - 1); j++)
-            {
-                int a = tour[i], b = tour[(i + 1) % n];
-                int c = tour[j], d = tour[(j + 1) % n];
-                int old_dist = distance(&cities[a], &cities[b]) + distance(&cities[c], &cities[d]);
-                int new_dist = distance(&cities[a], &cities[c]) + distance(&cities[b], &cities[d]);
-                if (new_dist < old_dist)
-                {
-                    reverse(tour, i + 1, j);
-                    improved = 1;
-                }
-            }
-        }
+        drop_heap_place(h, i, h->item[(i - 1) / 2]);
+        i = (i - 1) / 2;
     }
+    drop_heap_place(h, i, p);
 }
 
-// restirct how far aparat two cities can be, windows size parameter, to fasten the execution time for really large inputs
-void two_opt_local(City *cities, int *tour, int n, int window)
-{
-    int loop_counter = 0;
-    clock_t t_start_2opt = clock();
-    double max_seconds = 200; // experimental can be changed but done get rid of stuccink improvement can also be deactivated
-    int improved = 1, pass =0;;
-    while (improved)
-    {
-        // Check time at the top of each major pass
-        double elapsed = (double)(clock() - t_start_2opt) / CLOCKS_PER_SEC;
-        if (elapsed > max_seconds ) {
-            printf("2-opt local: Time limit of %.2f seconds reached, exiting early at pass %d\n", max_seconds, pass);
+static void drop_heap_down(DropHeap *h, int i)
+{
+    int p = h->item[i];
+    for (;;)
+    {
+        int c = 2 * i + 1;
+        if (c >= h->size)
             break;
-        }
+        if (c + 1 < h->size && h->key[h->item[c + 1]] > h->key[h->item[c]])
+            c++;
+        if (h->key[h->item[c]] <= h->key[p])
+            break;
+        drop_heap_place(h, i, h->item[c]);
+        i = c;
+    }
+    drop_heap_place(h, i, p);
+}
 
-        loop_counter = 0;
-        improved = 0;
-        for (int i = 0; i < n - 1; i++)
+// new saving of position p: kept in the heap while it is positive, taken out otherwise
+static void drop_heap_update(DropHeap *h, int p, long long saving)
+{
+    h->key[p] = saving;
+    int i = h->slot[p];
+    if (saving > 0 && i < 0)
+    {
+        drop_heap_place(h, h->size++, p);
+        drop_heap_up(h, h->size - 1);
+    }
+    else if (saving > 0)
+    {
+        drop_heap_up(h, i);
+        drop_heap_down(h, h->slot[p]);
+    }
+    else if (i >= 0)
+    {
+        h->slot[p] = -1;
+        if (i < --h->size) // the last item fills the hole
         {
-            if (loop_counter++ % 100 == 0) // print every 100th iteration debugging reason
-                printf("2-opt: loop_counter = %d / %d   : %d \n", loop_counter, n - 1, i);
-
-            int j_start = i + 2;
-            int j_end = (window > 0) ? (i + window) : n - 1;
-            if (j_end >= n)
-                j_end = n - 1;
-            for (int j = j_start; j <= j_end && (i != 0 || j != n - 1); j++)
-            {
-                int a = tour[i], b = tour[(i + 1) % n];
-                int c = tour[j], d = tour[(j + 1) % n];
-                int old_dist = distance(&cities[a], &cities[b]) + distance(&cities[c], &cities[d]);
-                int new_dist = distance(&cities[a], &cities[c]) + distance(&cities[b], &cities[d]);
-                if (new_dist < old_dist)
-                {
-                    reverse(tour, i + 1, j);
-                    improved = 1;
-                }
-            }
+            int q = h->item[h->size];
+            drop_heap_place(h, i, q);
+            drop_heap_up(h, i);
+            drop_heap_down(h, h->slot[q]);
         }
-        printf("out of the inner loop! passes done: %d\n", pass);
-        pass++;
+    }
+}
+
+// one specialized copy of the kernels per metric
+#define DIST(a, b) dist_euc_2d(a, b)
+#define KERNEL(name) name##_euc_2d
+#include "tsp_kernels.h"
+#undef DIST
+#undef KERNEL
+
+#define DIST(a, b) dist_ceil_2d(a, b)
+#define KERNEL(name) name##_ceil_2d
+#include "tsp_kernels.h"
+#undef DIST
+#undef KERNEL
+
+#define DIST(a, b) dist_att(a, b)
+#define KERNEL(name) name##_att
+#include "tsp_kernels.h"
+#undef DIST
+#undef KERNEL
+
+#define DIST(a, b) dist_geo(a, b)
+#define KERNEL(name) name##_geo
+#include "tsp_kernels.h"
+#undef DIST
+#undef KERNEL
+
+// the metric is picked once per call, every distance inside the kernel is a direct inlined one
+#define METRIC_DISPATCH(ctx, name, args) \
+    switch ((ctx)->metric)                \
+    {                                     \
+    case METRIC_CEIL_2D:                  \
+        name##_ceil_2d args;              \
+        break;                            \
+    case METRIC_ATT:                      \
+        name##_att args;                  \
+        break;                            \
+    case METRIC_GEO:                      \
+        name##_geo args;                  \
+        break;                            \
+    default:                              \
+        name##_euc_2d args;               \
+    }
+
+// Basic, full 2-opt
+void two_opt(SolverContext *ctx, City *cities, int *tour, int n)
+{
+    METRIC_DISPATCH(ctx, two_opt, (ctx, cities, tour, n))
+}
+
+// restirct how far aparat two cities can be, windows size parameter, to fasten the execution time for really large inputs
+void two_opt_local(SolverContext *ctx, City *cities, int *tour, int n, int window)
+{
+    METRIC_DISPATCH(ctx, two_opt_local, (ctx, cities, tour, n, window))
+}
+
+// 2-opt restricted to tour[lo..hi], used to repair seams
+void two_opt_segment(SolverContext *ctx, City *cities, int *tour, int n, int lo, int hi)
+{
+    METRIC_DISPATCH(ctx, two_opt_segment, (ctx, cities, tour, n, lo, hi))
+}
+
+// 2-opt over the edges of a candidate graph, seeds (if not NULL) are the only cities active at the start
+void two_opt_neighbors(SolverContext *ctx, City *cities, int *tour, int n, const CandidateGraph *cg, const int *seeds, int seed_count)
+{
+    METRIC_DISPATCH(ctx, two_opt_neighbors, (ctx, cities, tour, n, cg, seeds, seed_count))
+}
+
+// drop cities whose two tour edges cost more than the edge closing the gap plus their penalty, best
+// saving first, until no drop saves anything; returns the number of cities dropped
+int prune_tour(SolverContext *ctx, City *cities, int *tour, int *tour_size)
+{
+    switch (ctx->metric)
+    {
+    case METRIC_CEIL_2D:
+        return prune_tour_ceil_2d(ctx, cities, tour, tour_size);
+    case METRIC_ATT:
+        return prune_tour_att(ctx, cities, tour, tour_size);
+    case METRIC_GEO:
+        return prune_tour_geo(ctx, cities, tour, tour_size);
+    default:
+        return prune_tour_euc_2d(ctx, cities, tour, tour_size);
     }
 }
 
 // Run 2-opt on K random segments of size 'window'
-void two_opt_random_regions(City *cities, int *tour, int n, int window, int K)
+void two_opt_random_regions(SolverContext *ctx, City *cities, int *tour, int n, int window, int K)
 {
-    srand(time(NULL));
-    for (int k = 0; k < K; k++)
+    // progress.pass counts the regions done, a resumed run picks up at the next one with the same draws
+    for (int k = ctx->progress.pass; k < K && !solver_out_of_time(ctx); k++)
     {
-        printf("value of k: %d \n",k);
-        int start = rand() % n;
+        ctx->progress.pass = k;
+        ctx->progress.rng = ctx->rng;
+        if (ctx->verbose)
+            printf("value of k: %d \n",k);
+        int start = (int)(solver_rand(ctx) % (uint64_t)n);
         int end = start + window;
         if (end >= n)
             end = n - 1;
-        two_opt_local(cities, tour, n, end - start);
+        two_opt_local(ctx, cities, tour, n, end - start);
+        ctx->progress.pass = k + 1;
+        ctx->progress.rng = ctx->rng;
+        checkpoint_poll(ctx, tour, n, 0);
     }
 }
 
-// actual penalty logic: if connecting two cities directly each other + penalty costs less than original length skip the city
-// simple greedy
-int prune_tour(City *cities, int *tour, int *tour_size, int penalty)
+// output file format: "total_cost visited" line, then one visited city id per line
+int write_output(const char *filename, const City *cities, const int *tour, int tour_size, unsigned long long total_cost)
 {
-
-    int removed = 0;
-    int n = *tour_size;
-    int *to_remove = malloc(n * sizeof(int));
-    if (!to_remove)
+    FILE *fout = fopen(filename, "w");
+    if (!fout)
     {
-        fprintf(stderr, "Memory allocation failed in prune_tour.\n");
-        exit(1);
+        perror("Could not open output file");
+        return -1;
     }
+    fprintf(fout, "%llu %d\n", total_cost, tour_size);
+    for (int i = 0; i < tour_size; i++)
+        fprintf(fout, "%d\n", cities[tour[i]].id);
+    fprintf(fout, "\n");
+    fclose(fout);
+    return 0;
+}
 
-    // initialize
-    for (int i = 0; i < n; i++)
-        to_remove[i] = 0;
+static int compare_ids(const void *a, const void *b)
+{
+    const IdIndex *x = a, *y = b;
+    if (x->id != y->id)
+        return (x->id > y->id) - (x->id < y->id);
+    return (x->index > y->index) - (x->index < y->index); // an id listed twice finds its first city
+}
 
-    // try removing each city (except endpoints for a cycle)
-    for (int i = 0; i < n; i++)
+// buffers come from arena; returns the number of ids that appear more than once (the first city with
+// the id is the one found)
+int id_map_init(IdMap *m, Arena *arena, const City *cities, int n)
+{
+    int min_id = n > 0 ? cities[0].id : 0, max_id = min_id, duplicates = 0;
+    for (int c = 1; c < n; c++)
     {
-        if (n <= 3)
-            break; // base case: must have at least 3 cities for a cycle
-
-        int prev = (i - 1 + n) % n;
-        int next = (i + 1) % n;
-
-        int a = tour[prev], b = tour[i], c = tour[next]; // tour only contains indexes of the cities that is the same as array indexes but 1 less
-
-        int orig = distance(&cities[a], &cities[b]) + distance(&cities[b], &cities[c]);
-        int skip = distance(&cities[a], &cities[c]) + penalty;
-
-        if (skip < orig)
-        {
-            // mark for removal
-            to_remove[i] = 1;
-            removed++;
-        }
+        if (cities[c].id < min_id)
+            min_id = cities[c].id;
+        if (cities[c].id > max_id)
+            max_id = cities[c].id;
     }
-
-    // remove marked city from tour
-
-    if (removed > 0)
+    m->min_id = min_id;
+    m->range = (long long)max_id - min_id + 1;
+    m->n = n;
+    m->table = NULL;
+    m->sorted = NULL;
+    if (m->range <= 4LL * n + 1024)
     {
-        int m = 0;
-        int *new_tour = malloc(n * sizeof(int));
-        if (!new_tour)
+        m->table = arena_alloc(arena, (size_t)m->range * sizeof(int));
+        memset(m->table, -1, (size_t)m->range * sizeof(int));
+        for (int c = 0; c < n; c++)
         {
-            fprintf(stderr, "Memory allocation failed in prune_tour.\n");
-            exit(1);
+            int *slot = &m->table[cities[c].id - min_id];
+            if (*slot >= 0)
+                duplicates++;
+            else
+                *slot = c;
         }
-        for (int i = 0; i < n; i++)
-        {
-            if (!to_remove[i])
-                new_tour[m++] = tour[i];
-        }
-        for (int i = 0; i < m; i++)
-        {
-            tour[i] = new_tour[i];
-        }
-        *tour_size = m;
-
-        free(new_tour);
+        return duplicates;
     }
-
-    free(to_remove);
-
-    return removed; // return the number of removed elements
+    m->sorted = arena_alloc(arena, (size_t)n * sizeof(IdIndex) + sizeof(IdIndex));
+    for (int c = 0; c < n; c++)
+    {
+        m->sorted[c].id = cities[c].id;
+        m->sorted[c].index = c;
+    }
+    qsort(m->sorted, (size_t)n, sizeof(IdIndex), compare_ids);
+    for (int i = 1; i < n; i++)
+        if (m->sorted[i].id == m->sorted[i - 1].id)
+            duplicates++;
+    return duplicates;
 }
 
-int main(int argc, char *argv[])
+// index of the city with this id, -1 if there is none
+int id_map_find(const IdMap *m, int id)
 {
-    clock_t start = clock(); // <-- START HERE
-
-    int penalty;
-    int max_cities = DEFAULT_MAX_CITIES;
-    char *input_file = NULL;
-
-    // Parse arguments
-    if (argc < 2)
+    if (m->table)
     {
-        fprintf(stderr, "Usage: %s <inputfile> [--maxCities N]\n", argv[0]);
-        return 1;
+        long long k = (long long)id - m->min_id;
+        return k >= 0 && k < m->range ? m->table[k] : -1;
     }
-    input_file = argv[1];
-    if (argc >= 4 && strcmp(argv[2], "--maxCities") == 0)
+    int lo = 0, hi = m->n - 1, found = -1;
+    while (lo <= hi) // leftmost match
     {
-        max_cities = atoi(argv[3]);
-        if (max_cities <= 0)
+        int mid = lo + (hi - lo) / 2;
+        if (m->sorted[mid].id >= id)
         {
-            fprintf(stderr, "Invalid value for --maxCities\n");
-            return 1;
+            if (m->sorted[mid].id == id)
+                found = m->sorted[mid].index;
+            hi = mid - 1;
         }
+        else
+            lo = mid + 1;
     }
+    return found;
+}
 
-    // Now allocate city array using max_cities
-    City *cities = malloc(max_cities * sizeof(City));
-    if (!cities)
+// read back a tour written by write_output: the ids after the "total_cost visited" line
+// returns a malloc'ed array of *count ids, NULL on error
+int *read_tour(const char *filename, int *count)
+{
+    size_t len;
+    char *buf = read_file(filename, &len);
+    if (!buf)
+        return NULL;
+    const char *p = buf, *end = buf + len;
+    const char *eol = memchr(p, '\n', len);
+    p = eol ? eol + 1 : end; // cost line, recomputed anyway
+
+    int cap = 1024, n = 0;
+    int *ids = malloc((size_t)cap * sizeof(int));
+    while (ids && p < end)
     {
-        fprintf(stderr, "Failed to allocate memory for %d cities.\n", max_cities);
-        return 1;
+        eol = memchr(p, '\n', (size_t)(end - p));
+        int id;
+        if (parse_int(p, eol ? eol : end, &id))
+        {
+            if (n == cap)
+            {
+                cap *= 2;
+                int *grown = realloc(ids, (size_t)cap * sizeof(int));
+                if (!grown)
+                {
+                    free(ids);
+                    ids = NULL;
+                    break;
+                }
+                ids = grown;
+            }
+            ids[n++] = id;
+        }
+        p = eol ? eol + 1 : end;
     }
-
-    int n = read_input(input_file, &penalty, cities);
-    if (n > max_cities)
+    free(buf);
+    if (!ids)
     {
-        fprintf(stderr, "Input file has %d cities, but max allowed is %d.\n", n, max_cities);
-        n = max_cities;
+        fprintf(stderr, "Memory allocation failed reading tour %s.\n", filename);
+        return NULL;
     }
+    *count = n;
+    return ids;
+}
+
+void default_solve_options(SolveOptions *opt)
+{
+    opt->full_limit = 5000;
+    opt->local_limit = 20000;
+    opt->local_window = 500;    // windows can change based on the further tests
+    opt->region_window = 1000;
+    opt->regions = 20;          // randomness factor, region number and windows may be changed based on further tests
+    opt->prune_rounds = 5;      // number of prunes could be changed after some tests to optimize exectuion time over corerctness
+    opt->time_limit = 0;
+    opt->seed = 0;
+    opt->construct = CONSTRUCT_MORTON;
+    opt->decompose = 0;
+    opt->cluster_size = 2000;
+    opt->threads = 1;
+    opt->multilevel = 0;
+    opt->candidates = CANDIDATES_WINDOW;
+    opt->metric = METRIC_EUC_2D;
+    opt->verbose = 0;
+}
+
+// common start of every solve: run settings from opt into ctx, then Morton codes and the cities sorted
+// by them (for a good initial tour, and every spatial structure is faster over Morton ordered cities)
+void solver_begin(SolverContext *ctx, const SolveOptions *opt, City *cities, int n)
+{
+    ctx->verbose = opt->verbose;
+    ctx->metric = opt->metric;
+    ctx->deadline = opt->time_limit > 0 ? solver_now() + opt->time_limit : 0;
+    ctx->rng = opt->seed ? opt->seed : ((uint64_t)time(NULL) << 20) ^ (uint64_t)(uintptr_t)ctx ^ 0x9E3779B97F4A7C15ULL;
 
     // Find morton codes and sort the cities for good estimate of initial tour
-    // Step 1: Find min and max for x and y
-    int min_x = cities[0].x, max_x = cities[0].x;
-    int min_y = cities[0].y, max_y = cities[0].y;
-    for (int i = 1; i < n; i++)
-    {
-        if (cities[i].x < min_x)
-            min_x = cities[i].x;
-        if (cities[i].x > max_x)
-            max_x = cities[i].x;
-        if (cities[i].y < min_y)
-            min_y = cities[i].y;
-        if (cities[i].y > max_y)
-            max_y = cities[i].y;
-    }
+    assign_morton_codes(cities, n);
+    qsort(cities, n, sizeof(City), compare_morton);
+}
 
-    // Step 2: Map all coordinates to [0,65535] and assign Morton codes
-    for (int i = 0; i < n; i++)
+// the default pipeline: Morton order as base tour, 2-opt sized to n, prune, 2-opt again
+// cities get their Morton codes and are sorted in place, tour receives indexes into the sorted array
+void solve_instance(SolverContext *ctx, const SolveOptions *opt, City *cities, int n, int *tour, int *tour_size)
+{
+    solver_begin(ctx, opt, cities, n);
+
+    // big inputs: coarsen, solve small, refine level by level, see multilevel.c
+    if (opt->multilevel)
     {
-        int x_mapped = (max_x == min_x) ? 0 : (int)(((cities[i].x - min_x) * 65535.0) / (max_x - min_x));
-        int y_mapped = (max_y == min_y) ? 0 : (int)(((cities[i].y - min_y) * 65535.0) / (max_y - min_y));
-        cities[i].morton = morton_code(x_mapped, y_mapped);
+        solve_multilevel(ctx, opt, cities, n, tour, tour_size);
+        return;
     }
 
-    // assume initalized tour holds the order of morton order, it has nothing do with ids of the cities
-    int *tour = malloc(max_cities * sizeof(int));
-    if (!cities || !tour)
+    // big inputs: split into Morton clusters solved on their own, see decompose.c
+    if (opt->decompose && n > opt->cluster_size)
     {
-        fprintf(stderr, "Allocation failed!\n");
-        return 1;
+        solve_decomposed(ctx, opt, cities, n, tour, tour_size);
+        return;
     }
 
-    for (int i = 0; i < n; i++)
-        tour[i] = i;
-
-    printf("Initial tour length (Morton order): %llu\n", tour_length(cities, tour, n));
+    ctx->progress.phase = PHASE_CONSTRUCT;
+    ctx->progress.pass = 0;
+    ctx->progress.rng = ctx->rng;
+    solve_phases(ctx, opt, cities, n, tour, tour_size);
+}
 
-    // Choose 2-opt version based on the input size: 2-opt might blow the execution time if not restricted
-    // espicially for large input sizes, the choise of doing partial 2-opt thereof
+// on to the next phase, with a checkpoint of where we are if one is being kept
+static void next_phase(SolverContext *ctx, int phase, const int *tour, int tour_size)
+{
+    ctx->progress.phase = phase;
+    ctx->progress.pass = 0;
+    ctx->progress.rng = ctx->rng;
+    checkpoint_poll(ctx, tour, tour_size, 1);
+}
 
-    if (n <= 5000)
+// Choose 2-opt version based on the input size: 2-opt might blow the execution time if not restricted
+// espicially for large input sizes, the choise of doing partial 2-opt thereof
+// a candidate graph replaces the choice, neighbor-list 2-opt covers the whole tour at any size
+static void optimize_tour(SolverContext *ctx, const SolveOptions *opt, City *cities, int *tour, int tour_size, const CandidateGraph *cand)
+{
+    int size_class = ctx->progress.size_class;
+    if (cand && opt->candidates != CANDIDATES_WINDOW)
+    {
+        if (ctx->verbose)
+            printf("Running neighbor-list 2-opt...\n");
+        two_opt_neighbors(ctx, cities, tour, tour_size, cand, NULL, 0);
+    }
+    else if (size_class <= opt->full_limit)
     {
-        printf("Running full 2-opt...\n");
-        two_opt(cities, tour, n);
+        if (ctx->verbose)
+            printf("Running full 2-opt...\n");
+        two_opt(ctx, cities, tour, tour_size); // full 2-opt makes code slower, local 2-opt after pruning would cut down execution time
     }
-    else if (n <= 20000)
+    else if (size_class <= opt->local_limit)
     {
-        printf("Running local 2-opt with window 500...\n");
-        two_opt_local(cities, tour, n, 500); // windows can change based on the further tests
+        if (ctx->verbose)
+            printf("Running local 2-opt with window %d...\n", opt->local_window);
+        two_opt_local(ctx, cities, tour, tour_size, opt->local_window); // window or method of 2-opt may change to better utilize execution time
     }
     else
     {
-        printf("Running random-region 2-opt: 1000 regions, window 1000...\n");
-        two_opt_random_regions(cities, tour, n, 1000, 20); // randomness factor, region number and windows may be changed based on further tests
+        if (ctx->verbose)
+            printf("Running random-region 2-opt: %d regions, window %d...\n", opt->regions, opt->region_window);
+        two_opt_random_regions(ctx, cities, tour, tour_size, opt->region_window, opt->regions); // with big N and big K it takes a lot of time so test for moderity
     }
+}
 
-    printf("Improved tour length (after 2-opt): %llu\n", tour_length(cities, tour, n));
-
-    printf("Tour order (city IDs):\n");
-    for (int i = 0; i < n; i++)
-        printf("%d ", cities[tour[i]].id);
-    printf("\n");
-
-    // try to prune the tour if possible
-    // number of prunes could be changed after some tests to optimize exectuion time over corerctness
-
-    int tour_size = n;
-
-    if (n <= 5000)
+// the default pipeline from ctx->progress.phase on; a resumed run (checkpoint.c) comes in at a later
+// phase with its tour already in tour and the cost bookkeeping started
+void solve_phases(SolverContext *ctx, const SolveOptions *opt, City *cities, int n, int *tour, int *tour_size)
+{
+    if (ctx->progress.phase == PHASE_DONE)
+        return;
+
+    // candidate graph for neighbor-list 2-opt and for the constructions that take one; greedy needs one
+    // even with window 2-opt, Delaunay then since it does not depend on a k
+    ArenaMark mark = arena_mark(&ctx->arena);
+    CandidateGraph cg;
+    const CandidateGraph *cand = NULL;
+    int construct = ctx->progress.phase == PHASE_CONSTRUCT;
+    if (opt->candidates != CANDIDATES_WINDOW || (construct && opt->construct == CONSTRUCT_GREEDY))
     {
-        printf("Pruning 5 times...\n");
-        for (int i = 0; i < 5; i++)
-            prune_tour(cities, tour, &tour_size, penalty);
-        two_opt(cities, tour, tour_size); // 2-opt again after pruning - this could also be changed since full 2-opt makes code slower
-        // you may one to just make local 2-opt after pruning to cut down execution time or not do it at all
+        int kind = opt->candidates == CANDIDATES_WINDOW ? CANDIDATES_DELAUNAY : opt->candidates;
+        build_candidates(&ctx->arena, kind, ctx->metric, cities, n, CANDIDATE_NEIGHBORS, &cg);
+        cand = &cg;
+        if (ctx->verbose)
+            printf("Candidate graph (%s): %d edges\n", kind == CANDIDATES_DELAUNAY ? "delaunay" : "knn", cg.start[n]);
     }
-    else if (n <= 20000)
+
+    if (construct)
     {
-        printf("Pruning 5 times...\n");
-        for (int i = 0; i < 5; i++)
-            prune_tour(cities, tour, &tour_size, penalty);
-        two_opt_local(cities, tour, tour_size, 500); // this is 2-opt after pruning
-        // 2-opt window number of times or method of 2-opt full, local, random may change to better utilize execution time
+        // size that picks the 2-opt variant: the whole input, or only what insertion let onto the tour
+        ctx->progress.size_class = n;
+        if (opt->construct == CONSTRUCT_INSERTION)
+        {
+            *tour_size = construct_insertion(ctx, cities, n, cand, tour);
+            ctx->progress.size_class = *tour_size;
+            if (ctx->verbose)
+                printf("Initial tour length (cheapest insertion, %d of %d cities): %llu\n", *tour_size, n, ctx->tour_len);
+        }
+        else if (opt->construct == CONSTRUCT_GREEDY)
+        {
+            *tour_size = construct_greedy(ctx, cities, n, cand, tour);
+            if (ctx->verbose)
+                printf("Initial tour length (greedy edges): %llu\n", ctx->tour_len);
+        }
+        else
+        {
+            // initalized tour holds the morton order, it has nothing do with ids of the cities
+            for (int i = 0; i < n; i++)
+                tour[i] = i;
+            *tour_size = n;
+            solver_set_tour(ctx, cities, tour, n, n);
+            if (ctx->verbose)
+                printf("Initial tour length (Morton order): %llu\n", ctx->tour_len);
+        }
+        next_phase(ctx, PHASE_OPTIMIZE, tour, *tour_size);
     }
-    else
+
+    if (ctx->progress.phase == PHASE_OPTIMIZE)
     {
-        printf("Pruning 5 times...\n");
-        for (int i = 0; i < 5; i++)
-            prune_tour(cities, tour, &tour_size, penalty);
-        two_opt_random_regions(cities, tour, tour_size, 1000, 20); // further tests needed for better number of pruning or option of 2-opt based on execution time
-        // with big N and big K, number of times random region two opts it takes a lot of time so test for moderity
+        optimize_tour(ctx, opt, cities, tour, *tour_size, cand);
+        if (ctx->verbose)
+        {
+            printf("Improved tour length (after 2-opt): %llu\n", ctx->tour_len);
+            printf("Tour order (city IDs):\n");
+            for (int i = 0; i < *tour_size; i++)
+                printf("%d ", cities[tour[i]].id);
+            printf("\n");
+        }
+        next_phase(ctx, PHASE_PRUNE, tour, *tour_size);
     }
 
-    // Final cost calculations
-    unsigned long long final_tour_length = tour_length(cities, tour, tour_size);
-    int skipped = n - tour_size;
-    unsigned long long penalty_cost = (unsigned long long)skipped * (unsigned long long)penalty;
-    unsigned long long total_cost = final_tour_length + penalty_cost;
-
-    printf("Final tour after pruning and 2-opt:\n");
-    printf("  Cities visited : %d\n", tour_size);
-    printf("  Skipped cities : %d\n", skipped);
-    printf("  Penalty cost   : %llu\n", penalty_cost);
-    printf("  Tour length    : %llu\n", final_tour_length);
-    printf("  Total cost     : %llu\n", total_cost);
-
-    printf("Tour order (city IDs):\n");
-    for (int i = 0; i < tour_size; i++)
-        printf("%d ", cities[tour[i]].id);
-    printf("\n");
-
-    // === WRITING TO OUTPUTFILE ===
-
-    FILE *fout = fopen("output.txt", "w");
-    if (!fout)
+    // try to prune the tour if possible, then 2-opt again on what is left
+    if (ctx->progress.phase == PHASE_PRUNE)
     {
-        perror("Could not open output file");
-        return 1;
+        if (ctx->verbose)
+            printf("Pruning %d times...\n", opt->prune_rounds);
+        for (int i = 0; i < opt->prune_rounds; i++)
+            if (prune_tour(ctx, cities, tour, tour_size) == 0)
+                break;
+        next_phase(ctx, PHASE_REFINE, tour, *tour_size);
     }
 
-    fprintf(fout, "%llu %d\n", total_cost, tour_size);
-    for (int i = 0; i < tour_size; i++)
-        fprintf(fout, "%d\n", cities[tour[i]].id);
-    fprintf(fout, "\n");
-    fclose(fout);
-
-    free(cities);
-    free(tour);
-
-    // ==== ends here ===> execution time calculation
-    clock_t end = clock();
-    double elapsed_secs = (double)(end - start) / CLOCKS_PER_SEC;
-    printf("Execution time: %.8f seconds\n", elapsed_secs);
-
-    return 0;
+    if (ctx->progress.phase == PHASE_REFINE)
+    {
+        optimize_tour(ctx, opt, cities, tour, *tour_size, cand);
+        next_phase(ctx, PHASE_DONE, tour, *tour_size);
+    }
+    arena_release(&ctx->arena, mark);
 }
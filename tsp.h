@@ -0,0 +1,272 @@
+// tsp.h
+// solver core shared by the command line tool (main.c), the library wrapper (tspp.c) and the test programs
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include "city.h"
+#include "metric.h"
+
+#ifndef TSP_H
+#define TSP_H
+
+#define MAX_LINE 100
+#define DEFAULT_MAX_CITIES 5000
+#define TSPLIB_PENALTY 536870911 // TSPLIB instances visit every city: no skip saves this much, and d + it fits an int
+
+// scratch memory: every buffer the solver needs while optimizing is carved once from an arena
+// sized from n, so pruning and local search can run thousands of times without touching the heap
+typedef struct ArenaBlock
+{
+    struct ArenaBlock *next;
+    size_t size; // usable bytes in data
+    size_t used;
+    unsigned char data[];
+} ArenaBlock;
+
+typedef struct
+{
+    ArenaBlock *head;
+    ArenaBlock *cur;       // block allocations are served from
+    jmp_buf *on_failure;   // NULL: running out of memory ends the process, else arena_alloc longjmps here
+} Arena;
+
+// position in the arena to roll back to, taken before phase-local allocations
+typedef struct
+{
+    ArenaBlock *block;
+    size_t used;
+} ArenaMark;
+
+// phases of the default pipeline (solve_phases), what a checkpoint records and a resume starts from
+enum
+{
+    PHASE_CONSTRUCT, // starting tour
+    PHASE_OPTIMIZE,  // 2-opt sized to n
+    PHASE_PRUNE,
+    PHASE_REFINE,    // 2-opt again on what pruning left
+    PHASE_DONE
+};
+
+typedef struct
+{
+    int phase;      // PHASE_* being worked on
+    int pass;       // random regions done in this phase; the other phases run until nothing improves, so
+                    // they continue from the tour alone
+    uint64_t rng;   // ctx->rng when that region (or the phase) started
+    int size_class; // what picks the 2-opt variant, see solve_phases
+} SolverProgress;
+
+typedef struct Checkpointer Checkpointer; // periodic snapshots to disk (checkpoint.c)
+
+// solver working memory, owned by whoever drives the optimization (main, a library handle, ...)
+typedef struct
+{
+    Arena arena;
+    int capacity;  // number of cities the fixed buffers below are sized for
+    char *marks;   // per-position flags, e.g. cities marked for removal by prune_tour
+    int *scratch;  // n-sized scratch tour used when compacting
+
+    // running objective, kept exact by every move so nobody has to call tour_length() again
+    unsigned long long tour_len;
+    int skipped;
+    unsigned long long skip_cost; // sum of the penalties of the skipped cities
+    int total_cities;             // cities of the instance the values above are for, visited or not
+
+    int metric;      // METRIC_*, picks the kernel copy every optimization call runs
+    int verbose;     // progress output on stdout, off for library use
+    double deadline; // wall clock time (solver_now) after which optimization stops, 0 = none
+    uint64_t rng;    // state of solver_rand
+
+    SolverProgress progress;
+    Checkpointer *checkpoint; // NULL: no checkpoints, the kernels poll it at pass boundaries
+} SolverContext;
+
+// spatial index: uniform grid with a linked list of inserted cities per cell (grid.c)
+#define GRID_MAX_K 32
+typedef struct
+{
+    int cols, rows;
+    int min_x, min_y;
+    double cell; // side of a square cell
+    int *head;   // first city of each cell, -1 if empty
+    int *next;   // next city in the same cell
+} GridIndex;
+
+// sparse candidate edges for local search: neighbours of city c are adj[start[c] .. start[c+1]-1],
+// sorted closest first by the instance metric (two_opt_neighbors stops at the first one too far away)
+#define CANDIDATE_NEIGHBORS 8 // list length of knn candidate graphs in the pipeline
+typedef struct
+{
+    int *start;
+    int *adj;
+} CandidateGraph;
+
+// city id -> index into the cities array, for tours that come as ids (warm start, checkpoints, verify):
+// a direct table when the ids are (about) 1..n like in our inputs, sorted pairs otherwise
+typedef struct
+{
+    int id;
+    int index;
+} IdIndex;
+
+typedef struct
+{
+    int *table; // table[id - min_id], -1 for no city; NULL when sorted is used
+    int min_id;
+    long long range;
+    IdIndex *sorted;
+    int n;
+} IdMap;
+
+// how the starting tour is built
+enum
+{
+    CONSTRUCT_MORTON,    // every city in Morton order, pruning decides the skips later
+    CONSTRUCT_INSERTION, // penalty-aware cheapest insertion, decides the skips while building
+    CONSTRUCT_GREEDY     // greedy edge matching over the candidate graph, pruning decides the skips later
+};
+
+// where local search looks for moves
+enum
+{
+    CANDIDATES_WINDOW,  // 2-opt variant picked by size (full, windowed, random regions)
+    CANDIDATES_KNN,     // neighbor-list 2-opt over the k nearest cities
+    CANDIDATES_DELAUNAY // neighbor-list 2-opt over the Delaunay triangulation
+};
+
+// knobs of the default pipeline, see solve_instance
+typedef struct
+{
+    int full_limit;    // up to this many cities run full 2-opt
+    int local_limit;   // up to this many cities run windowed 2-opt, above it random regions
+    int local_window;  // window of two_opt_local
+    int region_window; // window of each random region
+    int regions;       // number of random regions
+    int prune_rounds;  // prune_tour passes before the final 2-opt
+    double time_limit; // seconds of wall time for the whole solve, 0 = no limit
+    uint64_t seed;     // random seed, 0 = from the clock
+    int construct;     // CONSTRUCT_*
+    int decompose;     // split inputs above cluster_size into spatial clusters solved in parallel
+    int cluster_size;  // cities per cluster
+    int threads;       // worker threads for the clusters
+    int multilevel;    // coarsen / solve / refine instead of the size based 2-opt choice
+    int candidates;    // CANDIDATES_*
+    int metric;        // METRIC_* of the instance, set by whoever loaded it (parse_instance)
+    int verbose;
+} SolveOptions;
+
+// binary instance format (written by gen_instances --binary): this header, then count records of
+// int32 id, x, y and, with TSPB_PER_CITY_PENALTY, penalty; native byte order (little-endian here)
+#define TSPB_MAGIC "TSPB"
+#define TSPB_VERSION 1
+#define TSPB_PER_CITY_PENALTY 1 // flag: records carry a penalty
+typedef struct
+{
+    char magic[4];
+    int32_t version;
+    int32_t penalty; // default penalty, the first line of the text format
+    int32_t flags;
+    int64_t count;
+} TspbHeader;
+
+// input
+int parse_input(const char *buf, size_t len, int *penalty, City *cities, int max_cities);
+int parse_binary(const char *buf, size_t len, int *penalty, City *cities, int max_cities);
+char *read_file(const char *filename, size_t *len);
+int read_input(const char *filename, int *penalty, City *cities);
+int parse_tsplib(const char *buf, size_t len, int *penalty, int *metric, City *cities, int max_cities);
+int parse_instance(const char *buf, size_t len, int *penalty, int *metric, City *cities, int max_cities);
+int write_output(const char *filename, const City *cities, const int *tour, int tour_size, unsigned long long total_cost);
+int *read_tour(const char *filename, int *count);
+int id_map_init(IdMap *m, Arena *arena, const City *cities, int n);
+int id_map_find(const IdMap *m, int id);
+
+// geometry
+uint32_t part1by1(uint32_t n);
+uint64_t morton_code(int x, int y);
+int compare_morton(const void *a, const void *b);
+void assign_morton_codes(City *cities, int n);
+int distance(const City *a, const City *b);
+
+// memory
+int arena_init(Arena *arena, size_t size);
+void arena_free(Arena *arena);
+void *arena_alloc(Arena *arena, size_t bytes);
+ArenaMark arena_mark(const Arena *arena);
+void arena_release(Arena *arena, ArenaMark mark);
+int solver_context_init(SolverContext *ctx, int n);
+int solver_context_reserve(SolverContext *ctx, int n);
+void arena_out_of_memory(Arena *arena, size_t size);
+void solver_context_free(SolverContext *ctx);
+
+// cost bookkeeping
+unsigned long long tour_length(const City *cities, const int *tour, int n);
+unsigned long long tour_length_metric(int metric, const City *cities, const int *tour, int n);
+void solver_set_tour(SolverContext *ctx, const City *cities, const int *tour, int tour_size, int total_cities);
+unsigned long long solver_total_cost(const SolverContext *ctx);
+double solver_now(void);
+
+// compile with -DTSP_DEBUG_COST to cross-check the running values against a full recomputation after each phase
+#ifdef TSP_DEBUG_COST
+void solver_check_cost(const SolverContext *ctx, const City *cities, const int *tour, int tour_size, const char *where);
+#define CHECK_COST(ctx, cities, tour, n, where) solver_check_cost(ctx, cities, tour, n, where)
+#else
+#define CHECK_COST(ctx, cities, tour, n, where) ((void)0)
+#endif
+uint64_t solver_rand(SolverContext *ctx);
+int solver_out_of_time(const SolverContext *ctx);
+
+// optimization
+void reverse(int *tour, int start, int end);
+void two_opt(SolverContext *ctx, City *cities, int *tour, int n);
+void two_opt_local(SolverContext *ctx, City *cities, int *tour, int n, int window);
+void two_opt_random_regions(SolverContext *ctx, City *cities, int *tour, int n, int window, int K);
+void two_opt_segment(SolverContext *ctx, City *cities, int *tour, int n, int lo, int hi);
+void two_opt_neighbors(SolverContext *ctx, City *cities, int *tour, int n, const CandidateGraph *cg, const int *seeds, int seed_count);
+int prune_tour(SolverContext *ctx, City *cities, int *tour, int *tour_size);
+
+// spatial index and construction
+void grid_init(GridIndex *g, Arena *arena, const City *cities, int n, int per_cell);
+void grid_insert(GridIndex *g, const City *cities, int c);
+int grid_nearest(const GridIndex *g, const City *cities, const City *p, int self, int k, int max_dist, int *out);
+void sort_candidates(int metric, const City *cities, int c, int *list, int len);
+void build_knn_candidates(Arena *arena, int metric, const City *cities, int n, int k, CandidateGraph *cg);
+void build_delaunay_candidates(Arena *arena, int metric, const City *cities, int n, CandidateGraph *cg);
+void build_candidates(Arena *arena, int kind, int metric, const City *cities, int n, int k, CandidateGraph *cg);
+int construct_insertion(SolverContext *ctx, const City *cities, int n, const CandidateGraph *cg, int *tour);
+int insert_missing(SolverContext *ctx, const City *cities, int n, const CandidateGraph *cg, int *tour, int tour_size, int *seeds, int *seed_count);
+int construct_greedy(SolverContext *ctx, const City *cities, int n, const CandidateGraph *cg, int *tour);
+
+// whole pipeline: Morton order, 2-opt, pruning, 2-opt again
+void default_solve_options(SolveOptions *opt);
+void solver_begin(SolverContext *ctx, const SolveOptions *opt, City *cities, int n);
+void solve_instance(SolverContext *ctx, const SolveOptions *opt, City *cities, int n, int *tour, int *tour_size);
+void solve_phases(SolverContext *ctx, const SolveOptions *opt, City *cities, int n, int *tour, int *tour_size);
+
+// decomposition (decompose.c): clusters solved on worker threads, stitched and repaired at the seams
+void solve_decomposed(SolverContext *ctx, const SolveOptions *opt, City *cities, int n, int *tour, int *tour_size);
+
+// multilevel (multilevel.c): match cities into coarser and coarser levels, solve the coarsest, refine back down
+void solve_multilevel(SolverContext *ctx, const SolveOptions *opt, City *cities, int n, int *tour, int *tour_size);
+
+// warm start (warmstart.c): continue from the tour of a previous run over a slightly changed instance
+void solve_warm_start(SolverContext *ctx, const SolveOptions *opt, City *cities, int n, const int *prev_ids, int prev_count, int *tour, int *tour_size);
+
+// penalty sweep (sweep.c): one tour through every city optimized once, then every penalty of the list
+// prunes and repairs its own copy of it; parse_penalty_list returns the list sorted, without duplicates
+int parse_penalty_list(const char *spec, int **out);
+int run_sweep(SolverContext *ctx, const SolveOptions *opt, City *cities, int n, int *penalties, int count, const char *output);
+
+// checkpoints (checkpoint.c): the default pipeline's state written to disk every interval seconds by a
+// writer thread, and a resume from such a file
+Checkpointer *checkpoint_start(const char *path, double interval, const City *cities, int n);
+void checkpoint_poll(SolverContext *ctx, const int *tour, int tour_size, int force);
+int checkpoint_finish(Checkpointer *cp, SolverContext *ctx, const int *tour, int tour_size);
+int *checkpoint_load(const char *path, const SolveOptions *opt, const City *cities, int n, SolverProgress *progress, int *count);
+void solve_resume(SolverContext *ctx, const SolveOptions *opt, City *cities, int n, const SolverProgress *from, const int *ids, int count, int *tour, int *tour_size);
+
+// batch mode (batch.c): solve every instance of a manifest on a pool of worker threads
+int run_batch(FILE *manifest, int threads, const SolveOptions *opt);
+
+#endif
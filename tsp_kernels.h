@@ -0,0 +1,290 @@
+// tsp_kernels.h
+// the hot loops of the solver, written once against DIST(a, b) and compiled once per metric: tsp.c
+// defines DIST and KERNEL(name) and includes this file for every metric (see metric.h), so each copy
+// has its distance inlined. not a normal header, no include guard, only tsp.c includes it
+
+// Basic, full 2-opt
+static void KERNEL(two_opt)(SolverContext *ctx, City *cities, int *tour, int n)
+{
+    int improved = 1;
+    while (improved)
+    {
+        improved = 0;
+        for (int i = 0; i < n - 1; i++)
+        {
+            if ((i & 255) == 0 && solver_out_of_time(ctx))
+                break; // solve budget used up, keep what we have
+            if ((i & 255) == 0)
+                checkpoint_poll(ctx, tour, n, 0); // between moves the tour is whole, a snapshot can be taken
+            for (int j = i + 2; j < n && (i != 0 || j != n - 1); j++)
+            {
+                int a = tour[i], b = tour[(i + 1) % n];
+                int c = tour[j], d = tour[(j + 1) % n];
+                int old_dist = DIST(&cities[a], &cities[b]) + DIST(&cities[c], &cities[d]);
+                int new_dist = DIST(&cities[a], &cities[c]) + DIST(&cities[b], &cities[d]);
+                if (new_dist < old_dist)
+                {
+                    reverse(tour, i + 1, j);
+                    ctx->tour_len -= old_dist - new_dist;
+                    improved = 1;
+                }
+            }
+        }
+    }
+    CHECK_COST(ctx, cities, tour, n, "two_opt");
+}
+
+// restirct how far aparat two cities can be, windows size parameter, to fasten the execution time for really large inputs
+static void KERNEL(two_opt_local)(SolverContext *ctx, City *cities, int *tour, int n, int window)
+{
+    int loop_counter = 0;
+    clock_t t_start_2opt = clock();
+    double max_seconds = 200; // experimental can be changed but done get rid of stuccink improvement can also be deactivated
+    int improved = 1, pass =0;;
+    while (improved)
+    {
+        // Check time at the top of each major pass
+        double elapsed = (double)(clock() - t_start_2opt) / CLOCKS_PER_SEC;
+        if (elapsed > max_seconds ) {
+            if (ctx->verbose)
+                printf("2-opt local: Time limit of %.2f seconds reached, exiting early at pass %d\n", max_seconds, pass);
+            break;
+        }
+        if (solver_out_of_time(ctx))
+            break;
+        checkpoint_poll(ctx, tour, n, 0);
+
+        loop_counter = 0;
+        improved = 0;
+        for (int i = 0; i < n - 1; i++)
+        {
+            if (loop_counter++ % 100 == 0 && ctx->verbose) // print every 100th iteration debugging reason
+                printf("2-opt: loop_counter = %d / %d   : %d \n", loop_counter, n - 1, i);
+
+            int j_start = i + 2;
+            int j_end = (window > 0) ? (i + window) : n - 1;
+            if (j_end >= n)
+                j_end = n - 1;
+            for (int j = j_start; j <= j_end && (i != 0 || j != n - 1); j++)
+            {
+                int a = tour[i], b = tour[(i + 1) % n];
+                int c = tour[j], d = tour[(j + 1) % n];
+                int old_dist = DIST(&cities[a], &cities[b]) + DIST(&cities[c], &cities[d]);
+                int new_dist = DIST(&cities[a], &cities[c]) + DIST(&cities[b], &cities[d]);
+                if (new_dist < old_dist)
+                {
+                    reverse(tour, i + 1, j);
+                    ctx->tour_len -= old_dist - new_dist;
+                    improved = 1;
+                }
+            }
+        }
+        if (ctx->verbose)
+            printf("out of the inner loop! passes done: %d\n", pass);
+        pass++;
+    }
+    CHECK_COST(ctx, cities, tour, n, "two_opt_local");
+}
+
+// 2-opt restricted to tour[lo..hi]: both removed edges start inside the segment and the reversal never
+// leaves it, so several disjoint segments could be worked on at once (used to repair seams)
+static void KERNEL(two_opt_segment)(SolverContext *ctx, City *cities, int *tour, int n, int lo, int hi)
+{
+    if (lo < 0)
+        lo = 0;
+    if (hi > n - 2)
+        hi = n - 2; // the edge (hi, hi+1) must exist without wrapping
+    int improved = 1;
+    while (improved && !solver_out_of_time(ctx))
+    {
+        improved = 0;
+        for (int i = lo; i < hi - 1; i++)
+        {
+            for (int j = i + 2; j <= hi; j++)
+            {
+                int a = tour[i], b = tour[i + 1];
+                int c = tour[j], d = tour[j + 1];
+                int old_dist = DIST(&cities[a], &cities[b]) + DIST(&cities[c], &cities[d]);
+                int new_dist = DIST(&cities[a], &cities[c]) + DIST(&cities[b], &cities[d]);
+                if (new_dist < old_dist)
+                {
+                    reverse(tour, i + 1, j);
+                    ctx->tour_len -= old_dist - new_dist;
+                    improved = 1;
+                }
+            }
+        }
+    }
+    CHECK_COST(ctx, cities, tour, n, "two_opt_segment");
+}
+
+// 2-opt over a candidate graph instead of a window: for every city a only the edges to its candidates
+// are tried, with don't-look bits so cities whose surroundings did not change are not looked at again.
+// seeds (if not NULL) are the only cities active at the start, e.g. around a changed part of the tour
+static void KERNEL(two_opt_neighbors)(SolverContext *ctx, City *cities, int *tour, int n, const CandidateGraph *cg, const int *seeds, int seed_count)
+{
+    if (n < 5)
+    {
+        KERNEL(two_opt)(ctx, cities, tour, n);
+        return;
+    }
+    ArenaMark mark = arena_mark(&ctx->arena);
+    int cities_total = 0; // tour holds indexes, pos must cover the largest one
+    for (int i = 0; i < n; i++)
+        if (tour[i] >= cities_total)
+            cities_total = tour[i] + 1;
+    int *pos = arena_alloc(&ctx->arena, (size_t)cities_total * sizeof(int));
+    char *active = arena_alloc(&ctx->arena, (size_t)cities_total * sizeof(char));
+    int *queue = arena_alloc(&ctx->arena, (size_t)n * sizeof(int)); // ring buffer, a city is in it at most once
+    memset(active, 0, (size_t)cities_total);
+    memset(pos, -1, (size_t)cities_total * sizeof(int)); // skipped cities stay at -1
+    for (int i = 0; i < n; i++)
+        pos[tour[i]] = i;
+
+    int head = 0, count = 0;
+#define PUSH(c)                                  \
+    do                                           \
+    {                                            \
+        if (!active[c])                          \
+        {                                        \
+            active[c] = 1;                       \
+            queue[(head + count++) % n] = (c);   \
+        }                                        \
+    } while (0)
+
+    if (seeds)
+    {
+        for (int i = 0; i < seed_count; i++)
+            if (seeds[i] < cities_total && pos[seeds[i]] >= 0)
+                PUSH(seeds[i]);
+    }
+    else
+    {
+        for (int i = 0; i < n; i++)
+            PUSH(tour[i]);
+    }
+
+    long long moves = 0, pops = 0;
+    while (count > 0)
+    {
+        if ((moves & 1023) == 0 && solver_out_of_time(ctx))
+            break;
+        if ((++pops & 4095) == 0)
+            checkpoint_poll(ctx, tour, n, 0);
+        int a = queue[head];
+        head = head + 1 == n ? 0 : head + 1;
+        count--;
+        active[a] = 0;
+
+        int improved = 0;
+        for (int dir = 0; dir < 2 && !improved; dir++)
+        {
+            // dir 0: edges (a, succ a) and (c, succ c); dir 1: edges (pred a, a) and (pred c, c)
+            int pa = pos[a];
+            int b = dir == 0 ? tour[pa + 1 == n ? 0 : pa + 1] : tour[pa == 0 ? n - 1 : pa - 1];
+            int d_ab = DIST(&cities[a], &cities[b]);
+            for (int e = cg->start[a]; e < cg->start[a + 1]; e++)
+            {
+                int c = cg->adj[e];
+                int d_ac = DIST(&cities[a], &cities[c]);
+                if (d_ac >= d_ab)
+                    break; // candidates are sorted, no gain possible from here on
+                int pc = c < cities_total ? pos[c] : -1;
+                if (pc < 0)
+                    continue; // not on the tour (skipped city)
+                int d = dir == 0 ? tour[pc + 1 == n ? 0 : pc + 1] : tour[pc == 0 ? n - 1 : pc - 1];
+                if (c == b || d == a)
+                    continue;
+                int delta = d_ac + DIST(&cities[b], &cities[d]) - d_ab - DIST(&cities[c], &cities[d]);
+                if (delta < 0)
+                {
+                    if (dir == 0)
+                        reverse_cyclic(tour, pos, n, pos[b], pos[c]); // a b ... c d -> a c ... b d
+                    else
+                        reverse_cyclic(tour, pos, n, pos[a], pos[d]); // b a ... d c -> b d ... a c
+                    ctx->tour_len += delta;
+                    PUSH(a);
+                    PUSH(b);
+                    PUSH(c);
+                    PUSH(d);
+                    improved = 1;
+                    moves++;
+                    break;
+                }
+            }
+        }
+    }
+#undef PUSH
+
+    if (ctx->verbose)
+        printf("Neighbor 2-opt: %lld moves, length %llu\n", moves, ctx->tour_len);
+    CHECK_COST(ctx, cities, tour, n, "two_opt_neighbors");
+    arena_release(&ctx->arena, mark);
+}
+
+// actual penalty logic: skip a city if connecting its two neighbours directly plus its penalty costs
+// less than going through it. drops are taken best saving first from a heap and each one only changes
+// the savings of its two neighbours, which are updated right away: two adjacent cities are never both
+// dropped on savings that assumed the other one stays
+static int KERNEL(prune_tour)(SolverContext *ctx, City *cities, int *tour, int *tour_size)
+{
+    int n = *tour_size;
+    if (n <= 1)
+        return 0;
+
+    // the tour as a linked list over positions, so order is kept without moving anything
+    ArenaMark mark = arena_mark(&ctx->arena);
+    int *prev = arena_alloc(&ctx->arena, (size_t)n * sizeof(int));
+    int *next = arena_alloc(&ctx->arena, (size_t)n * sizeof(int));
+    DropHeap h;
+    h.item = arena_alloc(&ctx->arena, (size_t)n * sizeof(int));
+    h.slot = arena_alloc(&ctx->arena, (size_t)n * sizeof(int));
+    h.key = arena_alloc(&ctx->arena, (size_t)n * sizeof(long long));
+    h.size = 0;
+
+#define SAVING(i) ((long long)DIST(&cities[tour[prev[i]]], &cities[tour[i]]) + DIST(&cities[tour[i]], &cities[tour[next[i]]]) \
+                   - DIST(&cities[tour[prev[i]]], &cities[tour[next[i]]]) - cities[tour[i]].penalty)
+    for (int i = 0; i < n; i++)
+    {
+        prev[i] = i == 0 ? n - 1 : i - 1;
+        next[i] = i + 1 == n ? 0 : i + 1;
+        h.slot[i] = -1;
+    }
+    for (int i = 0; i < n; i++)
+        drop_heap_update(&h, i, SAVING(i));
+
+    char *removed = ctx->marks;
+    memset(removed, 0, (size_t)n);
+    int m = n;
+    while (h.size > 0 && m > 1)
+    {
+        int i = h.item[0];
+        long long saving = h.key[i];
+        drop_heap_update(&h, i, 0); // out of the heap
+        int a = prev[i], c = next[i];
+        next[a] = c;
+        prev[c] = a;
+        removed[i] = 1;
+        m--;
+        ctx->tour_len -= (unsigned long long)(saving + cities[tour[i]].penalty);
+        ctx->skipped++;
+        ctx->skip_cost += (unsigned long long)cities[tour[i]].penalty;
+        drop_heap_update(&h, a, SAVING(a));
+        if (c != a)
+            drop_heap_update(&h, c, SAVING(c));
+    }
+#undef SAVING
+
+    if (m < n)
+    {
+        int k = 0;
+        for (int i = 0; i < n; i++)
+            if (!removed[i])
+                tour[k++] = tour[i];
+        *tour_size = m;
+    }
+    arena_release(&ctx->arena, mark);
+    CHECK_COST(ctx, cities, tour, *tour_size, "prune_tour");
+
+    return n - m; // return the number of removed elements
+}
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "tsp.h"
+
+// TSPLIB 95 reader for symmetric instances with node coordinates, so published optima can be used as
+// a benchmark. fills the same City array as parse_input:
+//   - EUC_2D, CEIL_2D, ATT coordinates are rounded to int (with a warning if that changed any of them)
+//   - GEO coordinates (DDD.MM) are kept as int(value * GEO_SCALE), metric.h undoes the scaling
+// TSPLIB has no penalties, every city has to be visited: every city's penalty (and *penalty) is set
+// above anything a skip saves.
+
+#define TSPLIB_LINE 256
+
+// "KEY : VALUE" or "KEY: VALUE" or "KEY VALUE", key and value trimmed into the buffers
+static void split_keyword(const char *line, char *key, char *value)
+{
+    int k = 0, v = 0;
+    while (*line && isspace((unsigned char)*line))
+        line++;
+    while (*line && !isspace((unsigned char)*line) && *line != ':' && k < TSPLIB_LINE - 1)
+        key[k++] = *line++;
+    key[k] = '\0';
+    while (*line && (isspace((unsigned char)*line) || *line == ':'))
+        line++;
+    while (*line && *line != '\n' && *line != '\r' && v < TSPLIB_LINE - 1)
+        value[v++] = *line++;
+    while (v > 0 && isspace((unsigned char)value[v - 1]))
+        v--;
+    value[v] = '\0';
+}
+
+int parse_tsplib(const char *buf, size_t len, int *penalty, int *metric, City *cities, int max_cities)
+{
+    const char *p = buf, *end = buf + len;
+    char line[TSPLIB_LINE], key[TSPLIB_LINE], value[TSPLIB_LINE];
+    int in_coords = 0, dimension = -1, city_count = 0, rounded = 0;
+    *metric = -1;
+
+    while (p < end)
+    {
+        const char *eol = memchr(p, '\n', (size_t)(end - p));
+        size_t n = (size_t)((eol ? eol : end) - p);
+        if (n >= sizeof(line))
+            n = sizeof(line) - 1;
+        memcpy(line, p, n);
+        line[n] = '\0';
+        p = eol ? eol + 1 : end;
+
+        split_keyword(line, key, value);
+        if (key[0] == '\0')
+            continue;
+        if (in_coords && (isdigit((unsigned char)key[0]) || key[0] == '-' || key[0] == '+'))
+        {
+            int id;
+            double x, y;
+            if (sscanf(line, "%d %lf %lf", &id, &x, &y) != 3)
+            {
+                fprintf(stderr, "Error: Bad TSPLIB coordinate line: %s\n", line);
+                return -1;
+            }
+            if (city_count < max_cities)
+            {
+                double scale = *metric == METRIC_GEO ? GEO_SCALE : 1.0;
+                cities[city_count].id = id;
+                cities[city_count].x = (int)lround(x * scale);
+                cities[city_count].y = (int)lround(y * scale);
+                cities[city_count].penalty = TSPLIB_PENALTY;
+                if (cities[city_count].x != x * scale || cities[city_count].y != y * scale)
+                    rounded++;
+            }
+            city_count++;
+            continue;
+        }
+        in_coords = 0;
+
+        if (strcmp(key, "EOF") == 0)
+            break;
+        else if (strcmp(key, "TYPE") == 0 && strcmp(value, "TSP") != 0)
+        {
+            fprintf(stderr, "Error: TSPLIB type %s is not supported (TSP only)\n", value);
+            return -1;
+        }
+        else if (strcmp(key, "DIMENSION") == 0)
+            dimension = atoi(value);
+        else if (strcmp(key, "EDGE_WEIGHT_TYPE") == 0)
+        {
+            if (strcmp(value, "EUC_2D") == 0)
+                *metric = METRIC_EUC_2D;
+            else if (strcmp(value, "CEIL_2D") == 0)
+                *metric = METRIC_CEIL_2D;
+            else if (strcmp(value, "ATT") == 0)
+                *metric = METRIC_ATT;
+            else if (strcmp(value, "GEO") == 0)
+                *metric = METRIC_GEO;
+            else
+            {
+                fprintf(stderr, "Error: TSPLIB edge weight type %s is not supported (EUC_2D, CEIL_2D, ATT, GEO)\n", value);
+                return -1;
+            }
+        }
+        else if (strcmp(key, "NODE_COORD_SECTION") == 0)
+        {
+            if (*metric < 0)
+            {
+                fprintf(stderr, "Error: TSPLIB NODE_COORD_SECTION before EDGE_WEIGHT_TYPE\n");
+                return -1;
+            }
+            in_coords = 1;
+        }
+        // NAME, COMMENT, DISPLAY_DATA_TYPE and the like do not matter here
+    }
+
+    if (*metric < 0)
+    {
+        fprintf(stderr, "Error: TSPLIB file without EDGE_WEIGHT_TYPE\n");
+        return -1;
+    }
+    if (dimension >= 0 && dimension != city_count)
+        fprintf(stderr, "Warning: TSPLIB DIMENSION is %d but %d cities were read\n", dimension, city_count);
+    if (rounded > 0 && *metric != METRIC_GEO)
+        fprintf(stderr, "Warning: %d cities had non-integer coordinates, rounded to integers (distances are approximate)\n", rounded);
+    else if (rounded > 0)
+        fprintf(stderr, "Warning: %d GEO coordinates have more than 3 decimals, rounded\n", rounded);
+    *penalty = TSPLIB_PENALTY;
+    return city_count;
+}
+
+// any format: binary instances start with TSPB_MAGIC, a TSPLIB file with a keyword, ours with the
+// penalty number
+int parse_instance(const char *buf, size_t len, int *penalty, int *metric, City *cities, int max_cities)
+{
+    if (len >= 4 && memcmp(buf, TSPB_MAGIC, 4) == 0)
+    {
+        *metric = METRIC_EUC_2D;
+        return parse_binary(buf, len, penalty, cities, max_cities);
+    }
+    size_t i = 0;
+    while (i < len && isspace((unsigned char)buf[i]))
+        i++;
+    if (i < len && isalpha((unsigned char)buf[i]))
+        return parse_tsplib(buf, len, penalty, metric, cities, max_cities);
+    *metric = METRIC_EUC_2D;
+    return parse_input(buf, len, penalty, cities, max_cities);
+}
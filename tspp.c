@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tsp.h"
+#include "tspp.h"
+
+// libtspp: thin handle around the solver core in tsp.c
+
+struct TsppSolver
+{
+    TsppOptions opt;
+    SolverContext ctx;
+    City *cities;
+    int *tour;
+    int *result_ids; // ids of the visited cities, what TsppResult.tour points to
+    int capacity;    // room in cities, tour and result_ids
+    int n;
+    int metric; // METRIC_* of the loaded instance
+    int tour_size;
+    int solved;
+};
+
+void tspp_default_options(TsppOptions *opt)
+{
+    SolveOptions so;
+    default_solve_options(&so);
+    opt->struct_size = sizeof(TsppOptions);
+    opt->full_limit = so.full_limit;
+    opt->local_limit = so.local_limit;
+    opt->local_window = so.local_window;
+    opt->region_window = so.region_window;
+    opt->regions = so.regions;
+    opt->prune_rounds = so.prune_rounds;
+    opt->verbose = so.verbose;
+    opt->seed = so.seed;
+    opt->construct = so.construct;
+    opt->decompose = so.decompose;
+    opt->cluster_size = so.cluster_size;
+    opt->threads = so.threads;
+    opt->multilevel = so.multilevel;
+    opt->candidates = TSPP_CANDIDATES_WINDOW;
+}
+
+TsppSolver *tspp_create(const TsppOptions *opt)
+{
+    // an older caller's options are a prefix of ours, whatever it did not know about stays at the default
+    if (opt && (opt->struct_size < offsetof(TsppOptions, full_limit) + sizeof(int) || opt->struct_size > sizeof(TsppOptions)))
+        return NULL;
+    TsppSolver *s = calloc(1, sizeof(TsppSolver));
+    if (!s)
+        return NULL;
+    tspp_default_options(&s->opt);
+    if (opt)
+    {
+        memcpy(&s->opt, opt, opt->struct_size);
+        s->opt.struct_size = sizeof(TsppOptions);
+    }
+    if (s->opt.multilevel && s->opt.construct != TSPP_CONSTRUCT_MORTON) // see solve_multilevel
+    {
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+void tspp_destroy(TsppSolver *s)
+{
+    if (!s)
+        return;
+    if (s->ctx.arena.head)
+        solver_context_free(&s->ctx);
+    free(s->cities);
+    free(s->tour);
+    free(s->result_ids);
+    free(s);
+}
+
+// grow the per-instance arrays, they are kept for the next instances
+static int reserve(TsppSolver *s, int n)
+{
+    if (n <= s->capacity)
+        return 0;
+    City *cities = realloc(s->cities, (size_t)n * sizeof(City));
+    if (cities)
+        s->cities = cities;
+    int *tour = realloc(s->tour, (size_t)n * sizeof(int));
+    if (tour)
+        s->tour = tour;
+    int *ids = realloc(s->result_ids, (size_t)n * sizeof(int));
+    if (ids)
+        s->result_ids = ids;
+    if (!cities || !tour || !ids)
+        return -1;
+    s->capacity = n;
+    return 0;
+}
+
+int tspp_load_text(TsppSolver *s, const char *text, size_t len)
+{
+    int penalty;
+    s->solved = 0;
+    int n = parse_instance(text, len, &penalty, &s->metric, s->cities, s->capacity);
+    if (n < 0)
+        return -1;
+    if (n > s->capacity) // first pass only counted, parse again with room for everything
+    {
+        if (reserve(s, n) < 0)
+            return -1;
+        parse_instance(text, len, &penalty, &s->metric, s->cities, s->capacity);
+    }
+    s->n = n;
+    return n;
+}
+
+int tspp_load_cities(TsppSolver *s, int penalty, const int *ids, const int *xs, const int *ys, int n)
+{
+    return tspp_load_cities_penalties(s, penalty, NULL, ids, xs, ys, n);
+}
+
+int tspp_load_cities_penalties(TsppSolver *s, int penalty, const int *penalties, const int *ids, const int *xs, const int *ys, int n)
+{
+    s->solved = 0;
+    if (n < 0 || reserve(s, n) < 0)
+        return -1;
+    for (int i = 0; i < n; i++)
+    {
+        s->cities[i].id = ids[i];
+        s->cities[i].x = xs[i];
+        s->cities[i].y = ys[i];
+        s->cities[i].penalty = penalties ? penalties[i] : penalty;
+    }
+    s->metric = METRIC_EUC_2D;
+    s->n = n;
+    return n;
+}
+
+// the solve with the arena's allocation failures turned into a -1 instead of exit(1)
+static int solve_guarded(TsppSolver *s, const SolveOptions *so)
+{
+    jmp_buf failed;
+    if (setjmp(failed))
+    {
+        s->ctx.arena.on_failure = NULL;
+        return -1;
+    }
+    s->ctx.arena.on_failure = &failed;
+    solve_instance(&s->ctx, so, s->cities, s->n, s->tour, &s->tour_size);
+    s->ctx.arena.on_failure = NULL;
+    return 0;
+}
+
+int tspp_solve(TsppSolver *s, double budget_seconds)
+{
+    s->solved = 0;
+    if (s->n <= 0)
+        return -1;
+
+    SolveOptions so;
+    default_solve_options(&so);
+    so.full_limit = s->opt.full_limit;
+    so.local_limit = s->opt.local_limit;
+    so.local_window = s->opt.local_window;
+    so.region_window = s->opt.region_window;
+    so.regions = s->opt.regions;
+    so.prune_rounds = s->opt.prune_rounds;
+    so.verbose = s->opt.verbose;
+    so.seed = s->opt.seed;
+    so.construct = s->opt.construct == TSPP_CONSTRUCT_INSERTION ? CONSTRUCT_INSERTION
+                   : s->opt.construct == TSPP_CONSTRUCT_GREEDY  ? CONSTRUCT_GREEDY
+                                                                : CONSTRUCT_MORTON;
+    so.decompose = s->opt.decompose;
+    so.cluster_size = s->opt.cluster_size > 0 ? s->opt.cluster_size : so.cluster_size;
+    so.threads = s->opt.threads;
+    so.multilevel = s->opt.multilevel;
+    so.candidates = s->opt.candidates == TSPP_CANDIDATES_DELAUNAY ? CANDIDATES_DELAUNAY
+                    : s->opt.candidates == TSPP_CANDIDATES_KNN    ? CANDIDATES_KNN
+                                                                  : CANDIDATES_WINDOW;
+    so.metric = s->metric;
+    so.time_limit = budget_seconds;
+
+    if (solver_context_reserve(&s->ctx, s->n) != 0 || solve_guarded(s, &so) != 0)
+        return -1;
+
+    for (int i = 0; i < s->tour_size; i++)
+        s->result_ids[i] = s->cities[s->tour[i]].id;
+    s->solved = 1;
+    return 0;
+}
+
+int tspp_get_result(const TsppSolver *s, TsppResult *out)
+{
+    if (!s->solved)
+        return -1;
+    out->total_cost = solver_total_cost(&s->ctx);
+    out->tour_length = s->ctx.tour_len;
+    out->visited = s->tour_size;
+    out->skipped = s->ctx.skipped;
+    out->tour = s->result_ids;
+    return 0;
+}
@@ -0,0 +1,96 @@
+// tspp.h
+// libtspp: TSP with penalties solver as a library, for calling in-process on many instances
+//
+//   TsppSolver *s = tspp_create(NULL);
+//   tspp_load_text(s, text, len);          // or tspp_load_cities(_penalties)
+//   tspp_solve(s, 0.05);                  // wall clock budget in seconds, 0 = none
+//   TsppResult r;
+//   tspp_get_result(s, &r);
+//   ... r.tour[0 .. r.visited-1] are city ids in visiting order ...
+//   tspp_destroy(s);
+//
+// a solver handle keeps its buffers between loads, so reusing one handle for a stream of instances
+// does no allocation once it has seen the largest instance. a handle must not be shared between
+// threads, use one per thread.
+//
+// build -- see "Library" in README.md for the ar line, link with -ltspp -lm -lpthread
+#include <stddef.h>
+
+#ifndef TSPP_H
+#define TSPP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct TsppSolver TsppSolver;
+
+#define TSPP_CONSTRUCT_MORTON 0    // every city in Morton order, skips decided by pruning afterwards
+#define TSPP_CONSTRUCT_INSERTION 1 // penalty-aware cheapest insertion, skips decided while building
+#define TSPP_CONSTRUCT_GREEDY 2    // greedy edge matching over the candidate graph, skips decided by pruning
+
+#define TSPP_CANDIDATES_WINDOW 0   // 2-opt variant picked by input size
+#define TSPP_CANDIDATES_KNN 1      // neighbor-list 2-opt over the 8 nearest cities
+#define TSPP_CANDIDATES_DELAUNAY 2 // neighbor-list 2-opt over the Delaunay triangulation
+
+// options grow at the end from one release to the next: struct_size tells the library which fields the
+// caller's header had, the rest keep their defaults. fill it with tspp_default_options, then change fields
+typedef struct
+{
+    size_t struct_size; // sizeof(TsppOptions) as the caller was compiled, set by tspp_default_options
+    int full_limit;    // up to this many cities run full 2-opt (default 5000)
+    int local_limit;   // up to this many cities run windowed 2-opt, above it random regions (default 20000)
+    int local_window;  // window of the windowed 2-opt (default 500)
+    int region_window; // window of each random region (default 1000)
+    int regions;       // number of random regions (default 20)
+    int prune_rounds;  // pruning passes (default 5)
+    int verbose;       // print progress on stdout like the command line tool (default 0)
+    unsigned long long seed; // random seed, 0 = from the clock (default 0)
+    int construct;     // starting tour: TSPP_CONSTRUCT_MORTON (default), _INSERTION or _GREEDY
+    int decompose;     // split big inputs into spatial clusters solved in parallel (default 0)
+    int cluster_size;  // cities per cluster (default 2000)
+    int threads;       // threads for the clusters (default 1)
+    int multilevel;    // coarsen / solve / refine, for 100k+ city inputs (default 0), only with _MORTON
+    int candidates;    // local search moves: TSPP_CANDIDATES_WINDOW (default), _KNN or _DELAUNAY
+} TsppOptions;
+
+typedef struct
+{
+    unsigned long long total_cost;  // tour length + penalties of the skipped cities
+    unsigned long long tour_length;
+    int visited;
+    int skipped;
+    const int *tour; // city ids in visiting order, valid until the next load, solve or destroy
+} TsppResult;
+
+void tspp_default_options(TsppOptions *opt);
+
+// opt may be NULL for the defaults; returns NULL if out of memory or if opt->struct_size is not one
+// this library knows (not set through tspp_default_options, or from a newer tspp.h), or if multilevel
+// is combined with another construction than TSPP_CONSTRUCT_MORTON
+TsppSolver *tspp_create(const TsppOptions *opt);
+void tspp_destroy(TsppSolver *s);
+
+// load an instance in the input file format ("penalty" line, then "id x y" or "id x y penalty" lines), the
+// binary format of gen_instances, or as a TSPLIB file
+// (EUC_2D, CEIL_2D, ATT or GEO, every city visited); returns the number of cities or -1 on error
+int tspp_load_text(TsppSolver *s, const char *text, size_t len);
+
+// load an instance from arrays, every city with the same penalty; returns n or -1 on error
+int tspp_load_cities(TsppSolver *s, int penalty, const int *ids, const int *xs, const int *ys, int n);
+
+// same with a penalty per city, penalties[i] for city i; penalties NULL gives every city penalty
+int tspp_load_cities_penalties(TsppSolver *s, int penalty, const int *penalties, const int *ids, const int *xs, const int *ys, int n);
+
+// solve the loaded instance within budget_seconds of wall time (0 = no limit), returns 0, or -1 if
+// nothing is loaded or memory ran out (the handle stays usable, e.g. for a smaller instance)
+int tspp_solve(TsppSolver *s, double budget_seconds);
+
+// result of the last tspp_solve, returns 0 or -1 if nothing was solved yet
+int tspp_get_result(const TsppSolver *s, TsppResult *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tsp.h"
+
+// solution verifier: checks an output file against its instance and recomputes the cost from scratch
+//   - every id on the tour exists in the instance and is visited once
+//   - the city count of the first line matches the tour
+//   - tour length (with the instance's metric, same distance functions as the solver) plus the
+//     penalties of the cities not on the tour equals the cost of the first line
+// the tour is checked line by line as it is read, the instance is parsed like the solver does it
+// exit code 0 if everything matches, 1 if not, 2 if a file could not be read
+// compile option -- gcc -O2 -o verify verify.c tsp.c grid.c insertion.c decompose.c multilevel.c delaunay.c greedy.c tsplib.c checkpoint.c -lm -lpthread
+
+#define VERIFY_MAX_REPORTS 10 // problems of one kind printed before only counting the rest
+
+static const char *skip_blanks(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        p++;
+    return p;
+}
+
+// decimal at p (after blanks), NULL if there is none
+static const char *parse_ll(const char *p, const char *end, long long *out)
+{
+    p = skip_blanks(p, end);
+    int neg = 0;
+    if (p < end && (*p == '-' || *p == '+'))
+        neg = (*p++ == '-');
+    if (p == end || *p < '0' || *p > '9')
+        return NULL;
+    unsigned long long v = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+        v = v * 10 + (unsigned long long)(*p++ - '0');
+    *out = neg ? -(long long)v : (long long)v;
+    return p;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3)
+    {
+        fprintf(stderr, "Usage: %s <inputfile> <outputfile>\n", argv[0]);
+        return 2;
+    }
+    double t0 = solver_now();
+
+    // instance: first pass only counts, second one fills the array
+    size_t len;
+    char *buf = read_file(argv[1], &len);
+    if (!buf)
+        return 2;
+    int penalty, metric;
+    int n = parse_instance(buf, len, &penalty, &metric, NULL, 0);
+    City *cities = n > 0 ? malloc((size_t)n * sizeof(City)) : NULL;
+    if (n > 0 && !cities)
+    {
+        fprintf(stderr, "Failed to allocate memory for %d cities.\n", n);
+        return 2;
+    }
+    if (n > 0)
+        parse_instance(buf, len, &penalty, &metric, cities, n);
+    free(buf);
+    if (n < 0)
+        return 2;
+
+    // id -> city index, the same lookup the solver uses for warm starts and checkpoints
+    Arena arena;
+    if (arena_init(&arena, (size_t)n * 2 * sizeof(int)) != 0)
+        return 2;
+    IdMap ids;
+    int errors = 0;
+    int duplicate_cities = id_map_init(&ids, &arena, cities, n);
+    if (duplicate_cities > 0)
+    {
+        printf("Instance lists %d id(s) more than once, the first of each is used\n", duplicate_cities);
+        errors++;
+    }
+
+    // tour: "total_cost visited" line, then one id per line, checked as it goes
+    buf = read_file(argv[2], &len);
+    if (!buf)
+        return 2;
+    const char *p = buf, *end = buf + len;
+    const char *eol = memchr(p, '\n', len);
+    long long claimed_cost = -1, claimed_visited = -1;
+    const char *q = parse_ll(p, eol ? eol : end, &claimed_cost);
+    if (!q || !parse_ll(q, eol ? eol : end, &claimed_visited))
+    {
+        printf("%s: first line is not \"total_cost visited\"\n", argv[2]);
+        errors++;
+    }
+    p = eol ? eol + 1 : end;
+
+    char *seen = calloc(n > 0 ? (size_t)n : 1, 1);
+    if (!seen)
+    {
+        fprintf(stderr, "Failed to allocate memory for %d cities.\n", n);
+        return 2;
+    }
+    unsigned long long length = 0, visited_penalty = 0;
+    int visited = 0, unknown = 0, repeated = 0, unreadable = 0, first = -1, prev = -1;
+    for (int line = 2; p < end; line++)
+    {
+        eol = memchr(p, '\n', (size_t)(end - p));
+        const char *line_end = eol ? eol : end;
+        long long v;
+        const char *r = parse_ll(p, line_end, &v);
+        const char *line_start = p;
+        p = eol ? eol + 1 : end;
+        if (!r || skip_blanks(r, line_end) != line_end)
+        {
+            if (skip_blanks(line_start, line_end) == line_end)
+                continue; // blank line, write_output ends the file with one
+            if (unreadable++ < VERIFY_MAX_REPORTS)
+                printf("Line %d: not a city id\n", line);
+            continue;
+        }
+        int c = v >= INT32_MIN && v <= INT32_MAX ? id_map_find(&ids, (int)v) : -1;
+        if (c < 0)
+        {
+            if (unknown++ < VERIFY_MAX_REPORTS)
+                printf("Line %d: id %lld is not in the instance\n", line, v);
+            continue;
+        }
+        if (seen[c])
+        {
+            if (repeated++ < VERIFY_MAX_REPORTS)
+                printf("Line %d: id %d is visited again\n", line, cities[c].id);
+            continue;
+        }
+        seen[c] = 1;
+        visited++;
+        visited_penalty += (unsigned long long)cities[c].penalty;
+        if (prev >= 0)
+            length += (unsigned long long)metric_distance(metric, &cities[prev], &cities[c]);
+        else
+            first = c;
+        prev = c;
+    }
+    free(buf);
+    if (visited > 1)
+        length += (unsigned long long)metric_distance(metric, &cities[prev], &cities[first]); // closing edge
+
+    unsigned long long all_penalty = 0;
+    for (int c = 0; c < n; c++)
+        all_penalty += (unsigned long long)cities[c].penalty;
+    unsigned long long penalty_cost = all_penalty - visited_penalty;
+    unsigned long long total = length + penalty_cost;
+
+    if (unknown > 0)
+    {
+        printf("%d id(s) not in the instance\n", unknown);
+        errors++;
+    }
+    if (unreadable > 0)
+    {
+        printf("%d line(s) that are not a city id\n", unreadable);
+        errors++;
+    }
+    if (repeated > 0)
+    {
+        printf("%d id(s) visited more than once (only the first visit is counted)\n", repeated);
+        errors++;
+    }
+    if (claimed_visited != (long long)visited + unknown + repeated)
+    {
+        printf("First line says %lld cities visited, the tour lists %d\n", claimed_visited, visited + unknown + repeated);
+        errors++;
+    }
+    if (claimed_cost < 0 || (unsigned long long)claimed_cost != total)
+    {
+        printf("First line says total cost %lld, recomputed %llu\n", claimed_cost, total);
+        errors++;
+    }
+
+    printf("Cities visited : %d of %d\n", visited, n);
+    printf("Tour length    : %llu\n", length);
+    printf("Penalty cost   : %llu\n", penalty_cost);
+    printf("Total cost     : %llu\n", total);
+    printf("%s (%.4f seconds)\n", errors ? "MISMATCH" : "OK", solver_now() - t0);
+
+    free(seen);
+    arena_free(&arena);
+    free(cities);
+    return errors ? 1 : 0;
+}
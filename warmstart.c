@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tsp.h"
+
+// warm start: production instances change a little between runs (a few cities added or removed, some
+// coordinates moved), so instead of solving from scratch the previous tour is taken over:
+//   1. its ids are mapped back to cities, ids that are gone are dropped (their neighbours get joined),
+//      and so are cities that look moved (both tour edges far longer than their neighbourhood)
+//   2. cities not on it (new, moved, or skipped last time) are inserted where that beats the penalty
+//   3. neighbor-list 2-opt starts only from the cities around those changes, plus the ends of edges
+//      that are still much longer than their neighbourhood, then pruning
+// everything else of the tour is left as it was, so a re-solve costs about as much as the candidate graph.
+
+void solve_warm_start(SolverContext *ctx, const SolveOptions *opt, City *cities, int n, const int *prev_ids, int prev_count, int *tour, int *tour_size)
+{
+    double t0 = solver_now();
+    solver_begin(ctx, opt, cities, n);
+    ArenaMark mark = arena_mark(&ctx->arena);
+
+    IdMap by_id;
+    id_map_init(&by_id, &ctx->arena, cities, n);
+
+    // seeds: 2 per gap (at most 2n + 2), 2 per moved city, 3 per inserted city and 2 per long edge
+    // (at most 2n, 3n and 2n), so 9n + 2 at worst
+    int *seeds = arena_alloc(&ctx->arena, (size_t)(9 * n + 4) * sizeof(int));
+    int seed_count = 0;
+
+    // 1. the old tour without the cities that are gone (or listed twice)
+    char *on_tour = ctx->marks;
+    memset(on_tour, 0, (size_t)n);
+    int m = 0, gap = 0, edge_gap = 0, vanished = 0;
+    for (int i = 0; i < prev_count; i++)
+    {
+        int c = id_map_find(&by_id, prev_ids[i]);
+        if (c < 0 || on_tour[c])
+        {
+            vanished++;
+            gap = 1;
+            continue;
+        }
+        if (gap && m > 0)
+        {
+            seeds[seed_count++] = tour[m - 1];
+            seeds[seed_count++] = c;
+        }
+        else if (gap)
+            edge_gap = 1; // the closing edge changed
+        gap = 0;
+        tour[m++] = c;
+        on_tour[c] = 1;
+    }
+    if ((gap || edge_gap) && m > 0)
+    {
+        seeds[seed_count++] = tour[m - 1];
+        seeds[seed_count++] = tour[0];
+    }
+    if (m == 0) // nothing to start from, e.g. the tour file was for another instance
+    {
+        if (ctx->verbose)
+            printf("Warm start: no city of the old tour is left, solving from scratch\n");
+        arena_release(&ctx->arena, mark);
+        solve_instance(ctx, opt, cities, n, tour, tour_size);
+        return;
+    }
+
+    CandidateGraph cg;
+    int kind = opt->candidates == CANDIDATES_KNN ? CANDIDATES_KNN : CANDIDATES_DELAUNAY;
+    build_candidates(&ctx->arena, kind, ctx->metric, cities, n, CANDIDATE_NEIGHBORS, &cg);
+
+    // a city both of whose tour edges reach past its farthest candidate has most likely moved: 2-opt
+    // cannot carry a single city across the map, so it comes off the tour and is inserted again below
+    int *reach = arena_alloc(&ctx->arena, (size_t)n * sizeof(int) + sizeof(int));
+    for (int c = 0; c < n; c++)
+        reach[c] = cg.start[c + 1] > cg.start[c] ? metric_distance(ctx->metric, &cities[c], &cities[cg.adj[cg.start[c + 1] - 1]]) : 0;
+    int *kept_tour = ctx->scratch, kept = 0, moved = 0;
+    for (int i = 0; i < m && m > 3; i++)
+    {
+        int p = tour[i == 0 ? m - 1 : i - 1], c = tour[i], nx = tour[i + 1 == m ? 0 : i + 1];
+        if (metric_distance(ctx->metric, &cities[p], &cities[c]) > reach[c] && metric_distance(ctx->metric, &cities[c], &cities[nx]) > reach[c])
+        {
+            seeds[seed_count++] = p;
+            seeds[seed_count++] = nx;
+            moved++;
+        }
+        else
+            kept_tour[kept++] = c;
+    }
+    if (m > 3)
+    {
+        memcpy(tour, kept_tour, (size_t)kept * sizeof(int));
+        m = kept;
+    }
+
+    // 2. everything not on it gets its chance against the penalty
+    *tour_size = insert_missing(ctx, cities, n, &cg, tour, m, seeds, &seed_count);
+    int inserted = *tour_size - m;
+
+    // 3. an edge longer than the farthest candidate of both its ends is out of place (e.g. where a whole
+    // group of cities moved); 2-opt looks at both ends
+    int long_edges = 0;
+    for (int i = 0; i < *tour_size; i++)
+    {
+        int a = tour[i], b = tour[i + 1 == *tour_size ? 0 : i + 1];
+        int d = metric_distance(ctx->metric, &cities[a], &cities[b]);
+        if (d > reach[a] && d > reach[b])
+        {
+            seeds[seed_count++] = a;
+            seeds[seed_count++] = b;
+            long_edges++;
+        }
+    }
+    if (ctx->verbose)
+        printf("Warm start: %d of %d old tour cities kept, %d vanished, %d moved, %d inserted, %d long edges, length %llu\n",
+               m, prev_count, vanished, moved, inserted, long_edges, ctx->tour_len);
+
+    two_opt_neighbors(ctx, cities, tour, *tour_size, &cg, seeds, seed_count);
+    for (int i = 0; i < opt->prune_rounds; i++)
+        if (prune_tour(ctx, cities, tour, tour_size) == 0)
+            break;
+    two_opt_neighbors(ctx, cities, tour, *tour_size, &cg, seeds, seed_count);
+
+    if (ctx->verbose)
+        printf("Warm start done: %d cities, length %llu, %.4f seconds\n", *tour_size, ctx->tour_len, solver_now() - t0);
+    arena_release(&ctx->arena, mark);
+}